@@ -0,0 +1,168 @@
+/* lfbitmap.c - lfbmload, lfbmsync, lfbmdalloc, lfbmialloc, lfbmfree */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ * lfbmuse  -  Set or clear the bit of a block in the in-memory bitmap
+ *		 and note that its sector of the bitmap changed
+ *------------------------------------------------------------------------
+ */
+local	void	lfbmuse(
+	  uint32	bit,		/* Bit of the block		*/
+	  bool8		inuse		/* TRUE to set, FALSE to clear	*/
+	)
+{
+	if (inuse) {
+		Lf_data.lf_bitmap[bit >> 3] |= 1 << (bit & 7);
+	} else {
+		Lf_data.lf_bitmap[bit >> 3] &= ~(1 << (bit & 7));
+	}
+	Lf_data.lf_bmdirty |= 1 << (bit / LF_BMSECTBITS);
+}
+
+/*------------------------------------------------------------------------
+ * lfbmfind  -  Find a clear bit in [first, last), starting the search at
+ *		  start and wrapping around; return SYSERR if none
+ *------------------------------------------------------------------------
+ */
+local	int32	lfbmfind(
+	  uint32	first,		/* First bit of the range	*/
+	  uint32	last,		/* One beyond its last bit	*/
+	  uint32	start		/* Bit to look at first		*/
+	)
+{
+	uint32	bit;			/* Bit being looked at		*/
+	uint32	n;			/* Bits looked at so far	*/
+
+	if (start < first || start >= last) {
+		start = first;
+	}
+	bit = start;
+	for (n = 0; n < last - first; n++, bit++) {
+		if (bit >= last) {
+			bit = first;
+		}
+
+		/* Skip over a whole byte of blocks in use at once */
+
+		if ((bit & 7) == 0 && bit + 8 <= last
+		    && Lf_data.lf_bitmap[bit >> 3] == 0xff) {
+			bit += 7;
+			n += 7;
+			continue;
+		}
+		if ((Lf_data.lf_bitmap[bit >> 3] & (1 << (bit & 7))) == 0) {
+			return bit;
+		}
+	}
+	return SYSERR;
+}
+
+/*------------------------------------------------------------------------
+ * lfbmload  -  Read the bitmap of a file system in the bitmap format
+ *		  into memory (assumes directory mutex held)
+ *------------------------------------------------------------------------
+ */
+status	lfbmload(void)
+{
+	struct	lfdir	*dirptr;	/* Ptr to in-memory directory	*/
+	uint32	nbits;			/* Bits in the bitmap		*/
+	uint32	i;			/* Sector of the bitmap		*/
+
+	dirptr = &Lf_data.lf_dir;
+	nbits = dirptr->lfd_nblks + dirptr->lfd_niblks;
+	if (nbits > LF_BMBITS) {
+		return SYSERR;
+	}
+	for (i = 0; i * LF_BMSECTBITS < nbits; i++) {
+		if (lfcread(Lf_data.lf_dskdev, lfbmstart(dirptr) + i, 0,
+			    (char *)&Lf_data.lf_bitmap[i * LF_BLKSIZ],
+			    LF_BLKSIZ) == SYSERR) {
+			return SYSERR;
+		}
+	}
+	Lf_data.lf_bmdirty = 0;
+	Lf_data.lf_bmrotor = lfbmstart(dirptr) + i;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * lfbmsync  -  Write the changed sectors of the bitmap (assumes
+ *		  directory mutex held)
+ *------------------------------------------------------------------------
+ */
+status	lfbmsync(void)
+{
+	uint32	i;			/* Sector of the bitmap		*/
+
+	for (i = 0; Lf_data.lf_bmdirty != 0; i++) {
+		if ((Lf_data.lf_bmdirty & (1 << i)) == 0) {
+			continue;
+		}
+		if (lfcwrite(Lf_data.lf_dskdev, lfbmstart(&Lf_data.lf_dir) + i,
+			     0, (char *)&Lf_data.lf_bitmap[i * LF_BLKSIZ],
+			     LF_BLKSIZ) == SYSERR) {
+			return SYSERR;
+		}
+		Lf_data.lf_bmdirty &= ~(1 << i);
+	}
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * lfbmdalloc  -  Allocate a data block, the one after near when it is
+ *		    free so that files are laid out in runs (assumes
+ *		    directory mutex held)
+ *------------------------------------------------------------------------
+ */
+dbid32	lfbmdalloc(
+	  dbid32	near		/* Previous block of the file,	*/
+					/*   or LF_DNULL		*/
+	)
+{
+	uint32	first;			/* First sector of the data area*/
+	int32	bit;			/* Bit of the block found	*/
+
+	first = lfbmstart(&Lf_data.lf_dir) + (Lf_data.lf_dir.lfd_nblks
+			+ Lf_data.lf_dir.lfd_niblks + LF_BMSECTBITS - 1)
+			/ LF_BMSECTBITS;
+	bit = lfbmfind(first, Lf_data.lf_dir.lfd_nblks,
+		near == LF_DNULL ? Lf_data.lf_bmrotor : near + 1);
+	if (bit == SYSERR) {
+		return LF_DNULL;
+	}
+	lfbmuse(bit, TRUE);
+	Lf_data.lf_bmrotor = bit + 1;
+	return (dbid32)bit;
+}
+
+/*------------------------------------------------------------------------
+ * lfbmialloc  -  Allocate an index block (assumes directory mutex held)
+ *------------------------------------------------------------------------
+ */
+ibid32	lfbmialloc(void)
+{
+	uint32	first;			/* Bit of i-block 0		*/
+	int32	bit;			/* Bit of the i-block found	*/
+
+	first = Lf_data.lf_dir.lfd_nblks;
+	bit = lfbmfind(first, first + Lf_data.lf_dir.lfd_niblks, first);
+	if (bit == SYSERR) {
+		return LF_INULL;
+	}
+	lfbmuse(bit, TRUE);
+	return (ibid32)(bit - first);
+}
+
+/*------------------------------------------------------------------------
+ * lfbmfree  -  Mark a data block or an index block free (assumes
+ *		  directory mutex held)
+ *------------------------------------------------------------------------
+ */
+void	lfbmfree(
+	  uint32	bit		/* Sector number of a data block*/
+					/*   or lfd_nblks + i-block ID	*/
+	)
+{
+	lfbmuse(bit, FALSE);
+}
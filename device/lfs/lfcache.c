@@ -0,0 +1,230 @@
+/* lfcache.c - lfcinit, lfcread, lfcwrite, lfcsync */
+
+#include <xinu.h>
+
+struct	lfcache	Lf_cache;
+
+/*------------------------------------------------------------------------
+ * lfcunlink  -  Take a buffer off the LRU list
+ *------------------------------------------------------------------------
+ */
+local	void	lfcunlink(
+	  int32		i		/* Index of the buffer		*/
+	)
+{
+	struct	lfcbuf	*cbptr;		/* Ptr to the buffer		*/
+
+	cbptr = &Lf_cache.lc_buf[i];
+	if (cbptr->cb_newer >= 0) {
+		Lf_cache.lc_buf[cbptr->cb_newer].cb_older = cbptr->cb_older;
+	} else {
+		Lf_cache.lc_newest = cbptr->cb_older;
+	}
+	if (cbptr->cb_older >= 0) {
+		Lf_cache.lc_buf[cbptr->cb_older].cb_newer = cbptr->cb_newer;
+	} else {
+		Lf_cache.lc_oldest = cbptr->cb_newer;
+	}
+}
+
+/*------------------------------------------------------------------------
+ * lfcnewest  -  Put a buffer at the most recently used end of the list
+ *------------------------------------------------------------------------
+ */
+local	void	lfcnewest(
+	  int32		i		/* Index of a buffer off the list*/
+	)
+{
+	struct	lfcbuf	*cbptr;		/* Ptr to the buffer		*/
+
+	cbptr = &Lf_cache.lc_buf[i];
+	cbptr->cb_newer = -1;
+	cbptr->cb_older = Lf_cache.lc_newest;
+	if (Lf_cache.lc_newest >= 0) {
+		Lf_cache.lc_buf[Lf_cache.lc_newest].cb_newer = i;
+	} else {
+		Lf_cache.lc_oldest = i;
+	}
+	Lf_cache.lc_newest = i;
+}
+
+/*------------------------------------------------------------------------
+ * lfcfind  -  Return the buffer holding a disk block, replacing the
+ *		 least recently used block when it is not cached (assumes
+ *		 the cache mutex is held)
+ *------------------------------------------------------------------------
+ */
+local	int32	lfcfind(
+	  did32		disk,		/* ID of the disk device	*/
+	  dbid32	blk,		/* Block number on the disk	*/
+	  bool8		load		/* Read the block on a miss	*/
+	)
+{
+	struct	lfcbuf	*cbptr;		/* Ptr to a buffer		*/
+	int32	*link;			/* Walks a hash chain		*/
+	int32	h;			/* Hash chain of the block	*/
+	int32	i;			/* Index of a buffer		*/
+
+	h = blk & (LFC_NHASH - 1);
+	for (i = Lf_cache.lc_hash[h]; i >= 0; i = cbptr->cb_hnext) {
+		cbptr = &Lf_cache.lc_buf[i];
+		if (cbptr->cb_blk == blk && cbptr->cb_disk == disk) {
+			Lf_cache.lc_hits++;
+			lfcunlink(i);
+			lfcnewest(i);
+			return i;
+		}
+	}
+	Lf_cache.lc_misses++;
+
+	/* Write back the least recently used block if it changed and	*/
+	/*   take it off its hash chain; if the write fails, the block	*/
+	/*   stays cached and changed rather than being lost		*/
+
+	i = Lf_cache.lc_oldest;
+	cbptr = &Lf_cache.lc_buf[i];
+	if (cbptr->cb_dirty) {
+		if (write(cbptr->cb_disk, cbptr->cb_data, cbptr->cb_blk)
+							== SYSERR) {
+			return SYSERR;
+		}
+		cbptr->cb_dirty = FALSE;
+		Lf_cache.lc_writebacks++;
+	}
+	if (cbptr->cb_blk != LF_DNULL) {
+		link = &Lf_cache.lc_hash[cbptr->cb_blk & (LFC_NHASH - 1)];
+		while (*link != i) {
+			link = &Lf_cache.lc_buf[*link].cb_hnext;
+		}
+		*link = cbptr->cb_hnext;
+		cbptr->cb_blk = LF_DNULL;
+	}
+	if (load && read(disk, cbptr->cb_data, blk) == SYSERR) {
+		return SYSERR;		/* Buffer stays empty and oldest*/
+	}
+
+	/* Give the buffer to the new block */
+
+	cbptr->cb_disk = disk;
+	cbptr->cb_blk = blk;
+	cbptr->cb_hnext = Lf_cache.lc_hash[h];
+	Lf_cache.lc_hash[h] = i;
+	lfcunlink(i);
+	lfcnewest(i);
+	return i;
+}
+
+/*------------------------------------------------------------------------
+ * lfcinit  -  Initialize the block cache with every buffer empty
+ *------------------------------------------------------------------------
+ */
+void	lfcinit(void)
+{
+	int32	i;
+
+	Lf_cache.lc_mutex = mutex_create("lfcache");
+	for (i = 0; i < LFC_NHASH; i++) {
+		Lf_cache.lc_hash[i] = -1;
+	}
+	Lf_cache.lc_newest = Lf_cache.lc_oldest = -1;
+	for (i = 0; i < LFC_NBUF; i++) {
+		Lf_cache.lc_buf[i].cb_blk = LF_DNULL;
+		Lf_cache.lc_buf[i].cb_dirty = FALSE;
+		lfcnewest(i);
+	}
+	Lf_cache.lc_hits = Lf_cache.lc_misses = 0;
+	Lf_cache.lc_writebacks = 0;
+}
+
+/*------------------------------------------------------------------------
+ * lfcread  -  Copy bytes of a disk block out of the cache
+ *------------------------------------------------------------------------
+ */
+status	lfcread(
+	  did32		disk,		/* ID of the disk device	*/
+	  dbid32	blk,		/* Block number on the disk	*/
+	  uint32	offset,		/* First byte within the block	*/
+	  char		*buff,		/* Buffer to hold the bytes	*/
+	  uint32	len		/* Number of bytes to copy	*/
+	)
+{
+	int32	i;			/* Buffer holding the block	*/
+
+	if (offset + len > LF_BLKSIZ) {
+		return SYSERR;
+	}
+	mutex_lock(Lf_cache.lc_mutex);
+	i = lfcfind(disk, blk, TRUE);
+	if (i == SYSERR) {
+		mutex_unlock(Lf_cache.lc_mutex);
+		return SYSERR;
+	}
+	memcpy(buff, &Lf_cache.lc_buf[i].cb_data[offset], len);
+	mutex_unlock(Lf_cache.lc_mutex);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * lfcwrite  -  Copy bytes into a disk block in the cache; the block
+ *		  reaches the disk when it is replaced or synced
+ *------------------------------------------------------------------------
+ */
+status	lfcwrite(
+	  did32		disk,		/* ID of the disk device	*/
+	  dbid32	blk,		/* Block number on the disk	*/
+	  uint32	offset,		/* First byte within the block	*/
+	  char		*buff,		/* Bytes to write		*/
+	  uint32	len		/* Number of bytes to copy	*/
+	)
+{
+	struct	lfcbuf	*cbptr;		/* Ptr to buffer of the block	*/
+	int32	i;			/* Buffer holding the block	*/
+
+	if (offset + len > LF_BLKSIZ) {
+		return SYSERR;
+	}
+
+	/* A write of the whole block need not read it first */
+
+	mutex_lock(Lf_cache.lc_mutex);
+	i = lfcfind(disk, blk, len < LF_BLKSIZ);
+	if (i == SYSERR) {
+		mutex_unlock(Lf_cache.lc_mutex);
+		return SYSERR;
+	}
+	cbptr = &Lf_cache.lc_buf[i];
+	memcpy(&cbptr->cb_data[offset], buff, len);
+	cbptr->cb_dirty = TRUE;
+	mutex_unlock(Lf_cache.lc_mutex);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * lfcsync  -  Write every changed block of a disk back to the disk
+ *------------------------------------------------------------------------
+ */
+status	lfcsync(
+	  did32		disk		/* ID of the disk device	*/
+	)
+{
+	struct	lfcbuf	*cbptr;		/* Ptr to a buffer		*/
+	status	retval;			/* OK unless a write failed	*/
+	int32	i;
+
+	retval = OK;
+	mutex_lock(Lf_cache.lc_mutex);
+	for (i = 0; i < LFC_NBUF; i++) {
+		cbptr = &Lf_cache.lc_buf[i];
+		if (!cbptr->cb_dirty || cbptr->cb_disk != disk) {
+			continue;
+		}
+		if (write(disk, cbptr->cb_data, cbptr->cb_blk) == SYSERR) {
+			retval = SYSERR;
+			continue;
+		}
+		cbptr->cb_dirty = FALSE;
+		Lf_cache.lc_writebacks++;
+	}
+	mutex_unlock(Lf_cache.lc_mutex);
+	return retval;
+}
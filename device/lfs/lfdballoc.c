@@ -6,23 +6,38 @@
 
 /*------------------------------------------------------------------------
  * lfdballoc  -  Allocate a new data block from free list on disk
- *			(assumes directory mutex held)
+ *			or from the bitmap (assumes directory mutex held)
  *------------------------------------------------------------------------
  */
 dbid32	lfdballoc (
-	  struct lfdbfree *dbuff /* Addr. of buffer to hold data block	*/
+	  struct lfdbfree *dbuff, /* Addr. of buffer to hold data block	*/
+	  dbid32	near	/* Previous block of the file or	*/
+				/*   LF_DNULL (bitmap format only)	*/
 	)
 {
 	dbid32	dnum;		/* ID of next d-block on the free list	*/
 	int32	retval;		/* Return value				*/
 
+	/* In the bitmap format, take a free block from the bitmap;	*/
+	/*   the directory does not change				*/
+
+	if (lfhasbitmap(&Lf_data.lf_dir)) {
+		dnum = lfbmdalloc(near);
+		if (dnum == LF_DNULL) {
+			panic("out of data blocks");
+		}
+		memset((char *)dbuff, DFILL, LF_BLKSIZ);
+		return dnum;
+	}
+
 	/* Get the ID of first data block on the free list */
 
 	dnum = Lf_data.lf_dir.lfd_dfree;
 	if (dnum == LF_DNULL) {	/* Ran out of free data blocks */
 		panic("out of data blocks");
 	}
-	retval = read(Lf_data.lf_dskdev, (char *)dbuff, dnum);
+	retval = lfcread(Lf_data.lf_dskdev, dnum, 0, (char *)dbuff,
+							LF_BLKSIZ);
 	if (retval == SYSERR) {
 		panic("lfdballoc cannot read disk block\n\r");
 	}
@@ -30,7 +45,8 @@ dbid32	lfdballoc (
 	/* Unlink d-block from in-memory directory */
 
 	Lf_data.lf_dir.lfd_dfree = dbuff->lf_nextdb;
-	write(Lf_data.lf_dskdev, (char *)&Lf_data.lf_dir, LF_AREA_DIR);
+	lfcwrite(Lf_data.lf_dskdev, LF_AREA_DIR, 0, (char *)&Lf_data.lf_dir,
+						sizeof(struct lfdir));
 	Lf_data.lf_dirdirty = FALSE;
 
 	/* Fill data block to erase old data */
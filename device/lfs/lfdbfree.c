@@ -16,10 +16,15 @@ status	lfdbfree(
 	struct	lfdbfree buf;		/* Buffer to hold data block	*/
 
 	dirptr = &Lf_data.lf_dir;
+	if (lfhasbitmap(dirptr)) {
+		lfbmfree(dnum);		/* Only the bitmap changes	*/
+		return OK;
+	}
 	buf.lf_nextdb = dirptr->lfd_dfree;
 	dirptr->lfd_dfree = dnum;
-	write(diskdev, (char *)&buf,   dnum);
-	write(diskdev, (char *)dirptr, LF_AREA_DIR);
+	lfcwrite(diskdev, dnum, 0, (char *)&buf, LF_BLKSIZ);
+	lfcwrite(diskdev, LF_AREA_DIR, 0, (char *)dirptr,
+						sizeof(struct lfdir));
 
 	return OK;
 }
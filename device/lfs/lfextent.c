@@ -0,0 +1,324 @@
+/* lfextent.c - lfxsetup, lfxtruncate */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ * lfxget  -  Read a node of an extent tree
+ *------------------------------------------------------------------------
+ */
+local	status	lfxget(
+	  dbid32	blk,		/* Disk block of the node	*/
+	  struct lfxnode *xnptr		/* Buffer to hold the node	*/
+	)
+{
+	return lfcread(Lf_data.lf_dskdev, blk, 0, (char *)xnptr,
+						sizeof(struct lfxnode));
+}
+
+/*------------------------------------------------------------------------
+ * lfxput  -  Write a node of an extent tree
+ *------------------------------------------------------------------------
+ */
+local	status	lfxput(
+	  dbid32	blk,		/* Disk block of the node	*/
+	  struct lfxnode *xnptr		/* Node to write		*/
+	)
+{
+	return lfcwrite(Lf_data.lf_dskdev, blk, 0, (char *)xnptr,
+						sizeof(struct lfxnode));
+}
+
+/*------------------------------------------------------------------------
+ * lfxsearch  -  Return the last entry of a node that starts at or
+ *		   before a file block (binary search)
+ *------------------------------------------------------------------------
+ */
+local	int32	lfxsearch(
+	  struct lfxnode *xnptr,	/* Node to search		*/
+	  uint32	fblk		/* File block number		*/
+	)
+{
+	int32	lo, hi, mid;		/* Entries still possible	*/
+
+	lo = 0;
+	hi = xnptr->xn_count - 1;
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (xnptr->xn_ext[mid].ex_fblk <= fblk) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+/*------------------------------------------------------------------------
+ * lfxmap  -  Find the disk block that holds a block of a file, or
+ *		LF_DNULL if the file does not reach it
+ *------------------------------------------------------------------------
+ */
+local	dbid32	lfxmap(
+	  struct lflcblk *lfptr,	/* Open file			*/
+	  uint32	fblk		/* File block number		*/
+	)
+{
+	struct	lfxnode	node;		/* Node on the path to fblk	*/
+	struct	lfextent *exptr;	/* Extent that may hold fblk	*/
+	dbid32	blk;			/* Disk block of the node	*/
+	int32	i;
+
+	/* Blocks of the last extent found need no search */
+
+	if (lfptr->lfxlen > 0 && fblk >= lfptr->lfxfblk
+	    && fblk - lfptr->lfxfblk < lfptr->lfxlen) {
+		return lfptr->lfxstart + (fblk - lfptr->lfxfblk);
+	}
+
+	if (lfptr->lfdirptr->ld_ilist == LF_INULL) {
+		return LF_DNULL;
+	}
+	blk = lfptr->lfdirptr->ld_ilist;
+	while (TRUE) {
+		if (lfxget(blk, &node) == SYSERR || node.xn_count == 0) {
+			return LF_DNULL;
+		}
+		i = lfxsearch(&node, fblk);
+		if (node.xn_level == 0) {
+			break;
+		}
+		blk = node.xn_ext[i].ex_start;
+	}
+	exptr = &node.xn_ext[i];
+	if (fblk < exptr->ex_fblk || fblk - exptr->ex_fblk >= exptr->ex_len) {
+		return LF_DNULL;
+	}
+	lfptr->lfxfblk = exptr->ex_fblk;
+	lfptr->lfxstart = exptr->ex_start;
+	lfptr->lfxlen = exptr->ex_len;
+	return exptr->ex_start + (fblk - exptr->ex_fblk);
+}
+
+/*------------------------------------------------------------------------
+ * lfxnew  -  Allocate and write a node holding one entry or none
+ *------------------------------------------------------------------------
+ */
+local	dbid32	lfxnew(
+	  int32		level,		/* Level of the node		*/
+	  struct lfextent *exptr	/* Its entry, or NULL		*/
+	)
+{
+	struct	lfxnode	node;		/* The new node			*/
+	dbid32	blk;			/* Its disk block		*/
+
+	blk = lfbmdalloc(LF_DNULL);
+	if (blk == LF_DNULL) {
+		panic("out of data blocks");
+	}
+	memset((char *)&node, NULLCH, sizeof(node));
+	node.xn_level = level;
+	if (exptr != NULL) {
+		node.xn_ext[0] = *exptr;
+		node.xn_count = 1;
+	}
+	lfxput(blk, &node);
+	return blk;
+}
+
+/*------------------------------------------------------------------------
+ * lfxappend  -  Add the disk block that holds the block just past the
+ *		   end of a file to its extent tree
+ *------------------------------------------------------------------------
+ */
+local	void	lfxappend(
+	  struct ldentry *ldptr,	/* Directory entry of the file	*/
+	  uint32	fblk,		/* File block being added	*/
+	  dbid32	dnum		/* Disk block that holds it	*/
+	)
+{
+	struct	lfxnode	node;		/* Node on the rightmost path	*/
+	struct	lfextent *exptr;	/* Last extent of the file	*/
+	dbid32	path[LF_XMAXLVL];	/* Interior nodes above the leaf*/
+	int32	depth;			/* Entries used in path		*/
+	dbid32	blk;			/* Disk block of the node	*/
+	struct	lfextent entry;		/* Entry to add to a new node	*/
+
+	/* Walk down the rightmost path to the last leaf */
+
+	blk = ldptr->ld_ilist;
+	lfxget(blk, &node);
+	depth = 0;
+	while (node.xn_level > 0) {
+		path[depth++] = blk;
+		blk = node.xn_ext[node.xn_count - 1].ex_start;
+		lfxget(blk, &node);
+	}
+
+	/* Grow the last extent when the new block follows it on disk */
+
+	if (node.xn_count > 0) {
+		exptr = &node.xn_ext[node.xn_count - 1];
+		if (exptr->ex_start + exptr->ex_len == dnum
+		    && exptr->ex_fblk + exptr->ex_len == fblk) {
+			exptr->ex_len++;
+			lfxput(blk, &node);
+			return;
+		}
+	}
+	if (node.xn_count < LF_XNENT) {
+		exptr = &node.xn_ext[node.xn_count++];
+		exptr->ex_fblk = fblk;
+		exptr->ex_start = dnum;
+		exptr->ex_len = 1;
+		lfxput(blk, &node);
+		return;
+	}
+
+	/* The leaf is full: start a new one, and add it to the parent,	*/
+	/*   starting a new parent when that one is full too		*/
+
+	entry.ex_fblk = fblk;
+	entry.ex_start = dnum;
+	entry.ex_len = 1;
+	entry.ex_start = lfxnew(0, &entry);
+	entry.ex_len = 0;
+	while (depth > 0) {
+		blk = path[--depth];
+		lfxget(blk, &node);
+		if (node.xn_count < LF_XNENT) {
+			node.xn_ext[node.xn_count++] = entry;
+			lfxput(blk, &node);
+			return;
+		}
+		entry.ex_start = lfxnew(node.xn_level, &entry);
+	}
+
+	/* The root is full: move its entries to a new node and make	*/
+	/*   the root, one level higher, point to that node and to the	*/
+	/*   new node of the same level					*/
+
+	blk = lfbmdalloc(LF_DNULL);
+	if (blk == LF_DNULL) {
+		panic("out of data blocks");
+	}
+	lfxput(blk, &node);
+	node.xn_level++;
+	node.xn_count = 2;
+	node.xn_ext[0].ex_start = blk;
+	node.xn_ext[0].ex_len = 0;
+	node.xn_ext[1] = entry;
+	lfxput(ldptr->ld_ilist, &node);
+}
+
+/*------------------------------------------------------------------------
+ * lfxfree  -  Free the data blocks and nodes of an extent (sub)tree
+ *------------------------------------------------------------------------
+ */
+local	void	lfxfree(
+	  dbid32	blk		/* Disk block of the node	*/
+	)
+{
+	struct	lfxnode	node;		/* The node			*/
+	struct	lfextent *exptr;	/* Walks its entries		*/
+	uint32	j;
+	int32	i;
+
+	if (lfxget(blk, &node) == SYSERR) {
+		return;
+	}
+	for (i = 0; i < node.xn_count; i++) {
+		exptr = &node.xn_ext[i];
+		if (node.xn_level > 0) {
+			lfxfree(exptr->ex_start);
+			continue;
+		}
+		for (j = 0; j < exptr->ex_len; j++) {
+			lfdbfree(Lf_data.lf_dskdev, exptr->ex_start + j);
+		}
+	}
+	lfdbfree(Lf_data.lf_dskdev, blk);
+}
+
+/*------------------------------------------------------------------------
+ * lfxsetup  -  Set a file's data block for the current file position
+ *		  in the extent format (assumes file mutex held)
+ *------------------------------------------------------------------------
+ */
+status	lfxsetup (
+	  struct lflcblk  *lfptr	/* Pointer to slave file device	*/
+	)
+{
+	struct	ldentry	*ldptr;		/* Ptr to file entry in dir.	*/
+	uint32	fblk;			/* File block of the position	*/
+	uint32	nfblks;			/* Blocks the file has		*/
+	dbid32	dnum;			/* Data block to fetch		*/
+	dbid32	near;			/* Last block of the file	*/
+
+	/* Obtain exclusive access to the directory */
+
+	mutex_lock(Lf_data.lf_mutex);
+	ldptr = lfptr->lfdirptr;
+
+	/* If the existing data block changed, write it to disk */
+
+	if (lfptr->lfdbdirty) {
+		lfflush(lfptr);
+	}
+
+	fblk = lfptr->lfpos / LF_BLKSIZ;
+	nfblks = (ldptr->ld_size + LF_BLKSIZ - 1) / LF_BLKSIZ;
+	dnum = lfxmap(lfptr, fblk);
+	if (dnum == LF_DNULL) {
+
+		/* A block of the file that cannot be found means the	*/
+		/*   tree could not be read				*/
+
+		if (fblk != nfblks) {
+			mutex_unlock(Lf_data.lf_mutex);
+			return SYSERR;
+		}
+
+		/* The position is just past the last block: give an	*/
+		/*   empty file its root, then allocate the next data	*/
+		/*   block after the last one, and add it to the tree	*/
+
+		if (ldptr->ld_ilist == LF_INULL) {
+			ldptr->ld_ilist = lfxnew(0, NULL);
+			Lf_data.lf_dirdirty = TRUE;
+		}
+		near = fblk > 0 ? lfxmap(lfptr, fblk - 1) : ldptr->ld_ilist;
+		dnum = lfdballoc((struct lfdbfree *)&lfptr->lfdblock, near);
+		lfxappend(ldptr, fblk, dnum);
+	} else if (dnum != lfptr->lfdnum) {
+		lfcread(Lf_data.lf_dskdev, dnum, 0, lfptr->lfdblock,
+							LF_BLKSIZ);
+		lfptr->lfdbdirty = FALSE;
+	}
+	lfptr->lfdnum = dnum;
+
+	/* Use current file offset to set the pointer to the next byte	*/
+	/*   within the data block					*/
+
+	lfptr->lfbyte = &lfptr->lfdblock[lfptr->lfpos & LF_DMASK];
+	mutex_unlock(Lf_data.lf_mutex);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * lfxtruncate  -  Free every block of a file in the extent format
+ *		     (assumes directory mutex held)
+ *------------------------------------------------------------------------
+ */
+void	lfxtruncate (
+	  struct lflcblk *lfptr		/* Ptr to file's cntl blk entry	*/
+	)
+{
+	struct	ldentry	*ldptr;		/* Pointer to file's dir. entry	*/
+
+	ldptr = lfptr->lfdirptr;
+	if (ldptr->ld_ilist != LF_INULL) {
+		lfxfree(ldptr->ld_ilist);
+	}
+	ldptr->ld_ilist = LF_INULL;
+	lfptr->lfxlen = 0;
+}
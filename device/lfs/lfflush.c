@@ -19,15 +19,22 @@ status	lfflush (
 	/* Write the directory if it has changed */
 
 	if (Lf_data.lf_dirdirty) {
-		write(Lf_data.lf_dskdev, (char *)&Lf_data.lf_dir,
-							LF_AREA_DIR);
+		lfcwrite(Lf_data.lf_dskdev, LF_AREA_DIR, 0,
+			(char *)&Lf_data.lf_dir, sizeof(struct lfdir));
 		Lf_data.lf_dirdirty = FALSE;
 	}
 
+	/* Write the sectors of the bitmap that have changed */
+
+	if (Lf_data.lf_bmdirty != 0) {
+		lfbmsync();
+	}
+
 	/* Write data block if it has changed */
 
 	if (lfptr->lfdbdirty) {
-		write(Lf_data.lf_dskdev, lfptr->lfdblock, lfptr->lfdnum);
+		lfcwrite(Lf_data.lf_dskdev, lfptr->lfdnum, 0,
+						lfptr->lfdblock, LF_BLKSIZ);
 		lfptr->lfdbdirty = FALSE;
 	}
 
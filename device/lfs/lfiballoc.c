@@ -4,7 +4,7 @@
 
 /*------------------------------------------------------------------------
  * lfiballoc  -  Allocate a new index block from free list on disk
- *			(assumes directory mutex held)
+ *			or from the bitmap (assumes directory mutex held)
  *------------------------------------------------------------------------
  */
 ibid32	lfiballoc (void)
@@ -12,6 +12,14 @@ ibid32	lfiballoc (void)
 	ibid32	ibnum;		/* ID of next block on the free list	*/
 	struct	lfiblk	iblock;	/* Buffer to hold an index block	*/
 
+	if (lfhasbitmap(&Lf_data.lf_dir)) {
+		ibnum = lfbmialloc();
+		if (ibnum == LF_INULL) {
+			panic("out of index blocks");
+		}
+		return ibnum;
+	}
+
 	/* Get ID of first index block on free list */
 
 	ibnum = Lf_data.lf_dir.lfd_ifree;
@@ -26,7 +34,8 @@ ibid32	lfiballoc (void)
 
 	/* Write a copy of the directory to disk after the change */
 
-	write(Lf_data.lf_dskdev, (char *) &Lf_data.lf_dir, LF_AREA_DIR);
+	lfcwrite(Lf_data.lf_dskdev, LF_AREA_DIR, 0, (char *)&Lf_data.lf_dir,
+						sizeof(struct lfdir));
 	Lf_data.lf_dirdirty = FALSE;
 
 	return ibnum;
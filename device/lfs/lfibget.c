@@ -13,19 +13,11 @@ void	lfibget(
 	  struct lfiblk	*ibuff		/* Buffer to hold index block	*/
 	)	
 {
-	char	*from, *to;		/* Pointers used in copying	*/
-	int32	i;			/* Loop index used during copy	*/
-	char	dbuff[LF_BLKSIZ];	/* Buffer to hold disk block	*/
+	/* Copy the index block out of the cached disk block that	*/
+	/*   contains it						*/
 
-	/* Read disk block that contains the specified index block */
-
-	read(diskdev, dbuff, ib2sect(inum));
-
-	/* Copy specified index block to caller's ibuff */
-
-	from = dbuff + ib2disp(inum);
-	to = (char *)ibuff;
-	for (i=0 ; i<sizeof(struct lfiblk) ; i++)
-		*to++ = *from++;
+	Lf_data.lf_ibgets++;
+	lfcread(diskdev, ib2sect(inum), ib2disp(inum), (char *)ibuff,
+						sizeof(struct lfiblk));
 	return;
 }
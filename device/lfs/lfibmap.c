@@ -0,0 +1,69 @@
+/* lfibmap.c - lfibmapgrow, lfibmapfree */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ * lfibmapgrow  -  Make room in an open file's map of index blocks for
+ *		     at least a given number of regions
+ *------------------------------------------------------------------------
+ */
+status	lfibmapgrow(
+	  struct lflcblk *lfptr,	/* Ptr to file's cntl blk entry	*/
+	  uint32	nregions	/* Entries the map must hold	*/
+	)
+{
+	ibid32	*newmap;		/* Larger map			*/
+	uint32	newmax;			/* Entries it has room for	*/
+	uint32	order;			/* Map holds 2^order frames	*/
+	uint32	frame;			/* Physical address of the map	*/
+
+	if (nregions <= lfptr->lfibmapmax) {
+		return OK;
+	}
+
+	/* Double the map, so that a growing file copies it rarely */
+
+	newmax = 2 * lfptr->lfibmapmax;
+	if (newmax < nregions) {
+		newmax = nregions;
+	}
+
+	/* Take the map from whole frames and reach it through the	*/
+	/*   direct map; the heap at KERNEL_END belongs to the caller	*/
+
+	order = Pages2Order(Bytes2Pages(newmax * sizeof(ibid32)));
+	frame = (uint32)GetPages(order);
+	if (frame == 0) {
+		return SYSERR;
+	}
+	newmap = (ibid32 *)(is_page ? (uint32)phys_to_virt(frame) : frame);
+	newmax = (PAGE_SIZE << order) / sizeof(ibid32);
+	if (lfptr->lfibmapped > 0) {
+		memcpy((char *)newmap, (char *)lfptr->lfibmap,
+				lfptr->lfibmapped * sizeof(ibid32));
+	}
+	lfibmapfree(lfptr);
+	lfptr->lfibmap = newmap;
+	lfptr->lfibmapmax = newmax;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * lfibmapfree  -  Release the memory of an open file's map of index
+ *		     blocks
+ *------------------------------------------------------------------------
+ */
+void	lfibmapfree(
+	  struct lflcblk *lfptr		/* Ptr to file's cntl blk entry	*/
+	)
+{
+	if (lfptr->lfibmap != NULL) {
+		FreePages((struct page *)(is_page
+				? virt_to_phys(lfptr->lfibmap)
+				: (uint32)lfptr->lfibmap),
+			Pages2Order(Bytes2Pages(lfptr->lfibmapmax
+						* sizeof(ibid32))));
+	}
+	lfptr->lfibmap = NULL;
+	lfptr->lfibmapmax = 0;
+}
@@ -15,24 +15,32 @@ devcall	lflclose (
 	/* Obtain exclusive use of the file */
 
 	lfptr = &lfltab[devptr->dvminor];
-	wait(lfptr->lfmutex);
+	mutex_lock(lfptr->lfmutex);
 
 	/* If file is not open, return an error */
 
 	if (lfptr->lfstate != LF_USED) {
-		signal(lfptr->lfmutex);
+		mutex_unlock(lfptr->lfmutex);
 		return SYSERR;
 	}
 
 	/* Write index or data blocks to disk if they have changed */
 
-	if (Lf_data.lf_dirdirty || lfptr->lfdbdirty || lfptr->lfibdirty) {
+	mutex_lock(Lf_data.lf_mutex);
+	if (Lf_data.lf_dirdirty || Lf_data.lf_bmdirty != 0
+	    || lfptr->lfdbdirty || lfptr->lfibdirty) {
 		lfflush(lfptr);
 	}
+	mutex_unlock(Lf_data.lf_mutex);
+
+	/* Write back the blocks the cache holds for the file system */
+
+	lfcsync(Lf_data.lf_dskdev);
 
 	/* Set device state to FREE and return to caller */
 
+	lfibmapfree(lfptr);
 	lfptr->lfstate = LF_FREE;
-	signal(lfptr->lfmutex);
+	mutex_unlock(lfptr->lfmutex);
 	return OK;
 }
@@ -18,12 +18,12 @@ devcall	lflgetc (
 	/* Obtain exclusive use of the file */
 
 	lfptr = &lfltab[devptr->dvminor];
-	wait(lfptr->lfmutex);
+	mutex_lock(lfptr->lfmutex);
 
 	/* If file is not open, return an error */
 
 	if (lfptr->lfstate != LF_USED) {
-		signal(lfptr->lfmutex);
+		mutex_unlock(lfptr->lfmutex);
 		return SYSERR;
 	}
 
@@ -31,15 +31,17 @@ devcall	lflgetc (
 
 	ldptr = lfptr->lfdirptr;
 	if (lfptr->lfpos >= ldptr->ld_size) {
-		signal(lfptr->lfmutex);
+		mutex_unlock(lfptr->lfmutex);
 		return EOF;
 	}
 
 	/* If byte pointer is beyond the current data block, set up	*/
 	/*	a new data block					*/
 
-	if (lfptr->lfbyte >= &lfptr->lfdblock[LF_BLKSIZ]) {
-		lfsetup(lfptr);
+	if (lfptr->lfbyte >= &lfptr->lfdblock[LF_BLKSIZ]
+	    && lfsetup(lfptr) == SYSERR) {
+		mutex_unlock(lfptr->lfmutex);
+		return SYSERR;
 	}
 
 	/* Extract the next byte from block, update file position, and	*/
@@ -47,6 +49,6 @@ devcall	lflgetc (
 
 	onebyte = 0xff & *lfptr->lfbyte++;
 	lfptr->lfpos++;
-	signal(lfptr->lfmutex);
+	mutex_unlock(lfptr->lfmutex);
 	return onebyte;
 }
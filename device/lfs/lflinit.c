@@ -21,7 +21,8 @@ devcall	lflinit (
 
 	lfptr->lfstate = LF_FREE;	/* Device is currently unused	*/
 	lfptr->lfdev = devptr->dvnum;	/* Set device ID		*/
-	lfptr->lfmutex = semcreate(1);	/* Create the mutex semaphore	*/
+	lfptr->lfmutex = mutex_create(devptr->dvname);	/* Create the	*/
+					/*   mutex for the file		*/
 
 	/* Initialize the directory and file position */
 
@@ -34,6 +35,8 @@ devcall	lflinit (
 	/* Zero the in-memory index block and data block */
 
 	lfptr->lfinum = LF_INULL;
+	lfptr->lfibmap = NULL;
+	lfptr->lfibmapmax = lfptr->lfibmapped = 0;
 	memset((char *) &lfptr->lfiblock, NULLCH, sizeof(struct lfiblk));
 	lfptr->lfdnum = 0;
 	memset((char *) &lfptr->lfdblock, NULLCH, LF_BLKSIZ);
@@ -18,12 +18,12 @@ devcall	lflputc (
 	/* Obtain exclusive use of the file */
 
 	lfptr = &lfltab[devptr->dvminor];
-	wait(lfptr->lfmutex);
+	mutex_lock(lfptr->lfmutex);
 
 	/* If file is not open, return an error */
 
 	if (lfptr->lfstate != LF_USED) {
-		signal(lfptr->lfmutex);
+		mutex_unlock(lfptr->lfmutex);
 		return SYSERR;
 	}
 
@@ -32,7 +32,7 @@ devcall	lflputc (
 
 	ldptr = lfptr->lfdirptr;
 	if (lfptr->lfpos > ldptr->ld_size) {
-		signal(lfptr->lfmutex);
+		mutex_unlock(lfptr->lfmutex);
 		return SYSERR;
 	}
 
@@ -42,7 +42,10 @@ devcall	lflputc (
 
 		/* Set up block for current file position */
 
-		lfsetup(lfptr);
+		if (lfsetup(lfptr) == SYSERR) {
+			mutex_unlock(lfptr->lfmutex);
+			return SYSERR;
+		}
 	}
 
 	/* If appending a byte to the file, increment the file size.	*/
@@ -59,6 +62,6 @@ devcall	lflputc (
 	lfptr->lfpos++;
 	lfptr->lfdbdirty = TRUE;
 
-	signal(lfptr->lfmutex);
+	mutex_unlock(lfptr->lfmutex);
 	return OK;
 }
@@ -3,7 +3,8 @@
 #include <xinu.h>
 
 /*------------------------------------------------------------------------
- * lflread  -  Read from a previously opened local file
+ * lflread  -  Read from a previously opened local file, copying whole
+ *		 spans of the data block and taking the file mutex once
  *------------------------------------------------------------------------
  */
 devcall	lflread (
@@ -12,28 +13,64 @@ devcall	lflread (
 	  int32	count			/* Max bytes to read		*/
 	)
 {
-	uint32	numread;		/* Number of bytes read		*/
-	int32	nxtbyte;		/* Character or SYSERR/EOF	*/
+	struct	lflcblk	*lfptr;		/* Ptr to open file table entry	*/
+	struct	ldentry	*ldptr;		/* Ptr to file's entry in the	*/
+					/*   in-memory directory	*/
+	int32	numread;		/* Number of bytes read		*/
+	int32	span;			/* Bytes to copy from the block	*/
 
 	if (count < 0) {
 		return SYSERR;
 	}
 
-	/* Iterate and use lflgetc to read individual bytes */
-
-	for (numread=0 ; numread < count ; numread++) {
-		nxtbyte = lflgetc(devptr);
-		if (nxtbyte == SYSERR) {
-			return SYSERR;
-		} else if (nxtbyte == EOF) {	/* EOF before finished */
-		    if (numread == 0) {
-			return EOF;
-		    } else {
-			return numread;
-		    }
-		} else {
-			*buff++ = (char) (0xff & nxtbyte);
+	/* Obtain exclusive use of the file */
+
+	lfptr = &lfltab[devptr->dvminor];
+	mutex_lock(lfptr->lfmutex);
+
+	/* If file is not open, return an error */
+
+	if (lfptr->lfstate != LF_USED) {
+		mutex_unlock(lfptr->lfmutex);
+		return SYSERR;
+	}
+
+	/* Return EOF for any attempt to read beyond the end-of-file */
+
+	ldptr = lfptr->lfdirptr;
+	if (count > 0 && lfptr->lfpos >= ldptr->ld_size) {
+		mutex_unlock(lfptr->lfmutex);
+		return EOF;
+	}
+
+	numread = 0;
+	while (numread < count && lfptr->lfpos < ldptr->ld_size) {
+
+		/* If byte pointer is beyond the current data block,	*/
+		/*	set up a new data block				*/
+
+		if (lfptr->lfbyte >= &lfptr->lfdblock[LF_BLKSIZ]
+		    && lfsetup(lfptr) == SYSERR) {
+			mutex_unlock(lfptr->lfmutex);
+			return numread > 0 ? numread : SYSERR;
+		}
+
+		/* Copy up to the end of the block, the end of the	*/
+		/*	file, or the end of the request			*/
+
+		span = &lfptr->lfdblock[LF_BLKSIZ] - lfptr->lfbyte;
+		if (span > count - numread) {
+			span = count - numread;
+		}
+		if (span > ldptr->ld_size - lfptr->lfpos) {
+			span = ldptr->ld_size - lfptr->lfpos;
 		}
+		memcpy(buff, lfptr->lfbyte, span);
+		buff += span;
+		lfptr->lfbyte += span;
+		lfptr->lfpos += span;
+		numread += span;
 	}
+	mutex_unlock(lfptr->lfmutex);
 	return numread;
 }
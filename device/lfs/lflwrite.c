@@ -3,7 +3,9 @@
 #include <xinu.h>
 
 /*------------------------------------------------------------------------
- * lflwrite  --  Write data to a previously opened local disk file
+ * lflwrite  --  Write data to a previously opened local disk file,
+ *		   copying whole spans into the data block and taking the
+ *		   file mutex once
  *------------------------------------------------------------------------
  */
 devcall	lflwrite (
@@ -12,18 +14,67 @@ devcall	lflwrite (
 	  int32	count			/* Number of bytes to write	*/
 	)
 {
-	int32		i;		/* Number of bytes written	*/
+	struct	lflcblk	*lfptr;		/* Ptr to open file table entry	*/
+	struct	ldentry	*ldptr;		/* Ptr to file's entry in the	*/
+					/*  in-memory directory		*/
+	int32	numwritten;		/* Number of bytes written	*/
+	int32	span;			/* Bytes to copy into the block	*/
 
 	if (count < 0) {
 		return SYSERR;
 	}
 
-	/* Iteratate and write one byte at a time */
+	/* Obtain exclusive use of the file */
 
-	for (i=0; i<count; i++) {
-		if (lflputc(devptr, *buff++) == SYSERR) {
+	lfptr = &lfltab[devptr->dvminor];
+	mutex_lock(lfptr->lfmutex);
+
+	/* If file is not open, return an error */
+
+	if (lfptr->lfstate != LF_USED) {
+		mutex_unlock(lfptr->lfmutex);
+		return SYSERR;
+	}
+
+	/* Return SYSERR for an attempt to skip bytes beyond the byte	*/
+	/* 	that is currently the end of the file		 	*/
+
+	ldptr = lfptr->lfdirptr;
+	if (lfptr->lfpos > ldptr->ld_size) {
+		mutex_unlock(lfptr->lfmutex);
+		return SYSERR;
+	}
+
+	for (numwritten = 0; numwritten < count; numwritten += span) {
+
+		/* If pointer is outside current block, set up new block */
+
+		if (lfptr->lfbyte >= &lfptr->lfdblock[LF_BLKSIZ]
+		    && lfsetup(lfptr) == SYSERR) {
+			mutex_unlock(lfptr->lfmutex);
 			return SYSERR;
 		}
+
+		/* Copy up to the end of the block or of the request,	*/
+		/*	and mark the block "dirty"			*/
+
+		span = &lfptr->lfdblock[LF_BLKSIZ] - lfptr->lfbyte;
+		if (span > count - numwritten) {
+			span = count - numwritten;
+		}
+		memcpy(lfptr->lfbyte, buff, span);
+		buff += span;
+		lfptr->lfbyte += span;
+		lfptr->lfpos += span;
+		lfptr->lfdbdirty = TRUE;
+
+		/* If appending to the file, increase the file size */
+
+		if (lfptr->lfpos > ldptr->ld_size) {
+			ldptr->ld_size = lfptr->lfpos;
+			Lf_data.lf_dirdirty = TRUE;
+		}
 	}
+	mutex_unlock(lfptr->lfmutex);
 	return count;
 }
@@ -3,6 +3,47 @@
 #include <xinu.h>
 #include <ramdisk.h>
 
+/*------------------------------------------------------------------------
+ * lfsckbitmap  -  Count the free data blocks and i-blocks in the bitmap
+ *		     of a file system in the bitmap format
+ *------------------------------------------------------------------------
+ */
+local	status	lfsckbitmap (
+	  did32		disk,		/* ID of an open disk device	*/
+	  struct lfdir	*dirptr		/* Directory read from the disk	*/
+	)
+{
+	uint32	nbits;			/* Bits in the bitmap		*/
+	uint32	bit;			/* Walks the bitmap		*/
+	uint32	dfree, ifree;		/* Free blocks found		*/
+	byte	bmbuf[LF_BLKSIZ];	/* One sector of the bitmap	*/
+
+	nbits = dirptr->lfd_nblks + dirptr->lfd_niblks;
+	if (nbits > LF_BMBITS) {
+		panic("bitmap is too large");
+	}
+	dfree = ifree = 0;
+	for (bit = 0; bit < nbits; bit++) {
+		if (bit % LF_BMSECTBITS == 0) {
+			lfcread(disk, lfbmstart(dirptr) + bit / LF_BMSECTBITS,
+				0, (char *)bmbuf, LF_BLKSIZ);
+		}
+		if (bmbuf[(bit % LF_BMSECTBITS) >> 3] & (1 << (bit & 7))) {
+			continue;
+		}
+		if (bit < dirptr->lfd_nblks) {
+			dfree++;
+		} else {
+			ifree++;
+		}
+	}
+	kprintf("Bitmap at sector %d: %d of %d index blocks free\n\r",
+		lfbmstart(dirptr), ifree, dirptr->lfd_niblks);
+	kprintf("Found %d free data blocks of %d sectors\n\r", dfree,
+		dirptr->lfd_nblks);
+	return OK;
+}
+
 /*------------------------------------------------------------------------
  * lfckfmt  -  Check the format of an initially-created disk
  *------------------------------------------------------------------------
@@ -23,7 +64,8 @@ status	lfsckfmt (
 
 	/* Read directory */
 
-	retval = read(disk,(char *)&dir, LF_AREA_DIR);
+	retval = lfcread(disk, LF_AREA_DIR, 0, (char *)&dir,
+						sizeof(struct lfdir));
 	if (retval == SYSERR) {
 		panic("cannot read directory");
 	}
@@ -37,6 +79,12 @@ status	lfsckfmt (
 	}
 	kprintf("Directory corresponds to a local Xinu file system\n");
 
+	/* A file system in the bitmap format has no free lists */
+
+	if (lfhasbitmap(&dir)) {
+		return lfsckbitmap(disk, &dir);
+	}
+
 	/* Follow index block list */
 
 	lfiblks = 0;
@@ -57,7 +105,7 @@ status	lfsckfmt (
 	kprintf("initial data block is %d\n\r", nextdb);
 	while (nextdb != LF_DNULL) {
 		dblks++;
-		read(disk, (char *)&dblock, nextdb);
+		lfcread(disk, nextdb, 0, (char *)&dblock, LF_BLKSIZ);
 		nextdb = dblock.lf_nextdb;
 	}
 	kprintf("Found %d data blocks\n\r", dblks);
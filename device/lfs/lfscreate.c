@@ -4,13 +4,67 @@
 #include <ramdisk.h>
 
 /*------------------------------------------------------------------------
- * lfscreate  -  Create an initially-empty file system on a disk
+ * lfsbitmap  -  Lay out the bitmap of a file system in the bitmap or
+ *		   the extent format and write it and the directory
+ *------------------------------------------------------------------------
+ */
+local	status	lfsbitmap (
+	  did32		disk,		/* ID of an open disk device	*/
+	  struct lfdir	*dirptr,	/* Directory with the file	*/
+					/*   system ID filled in	*/
+	  int32		format,		/* LF_VERS_BITMAP or _EXTENT	*/
+	  uint32	sectors,	/* Number of sectors to use	*/
+	  uint32	lfiblks,	/* Number of i-blocks		*/
+	  uint32	ibsectors	/* Number of sectors of i-blocks*/
+	)
+{
+	uint32	nbits;			/* Bits in the bitmap		*/
+	uint32	bmsectors;		/* Sectors of the bitmap	*/
+	uint32	inuse;			/* Sectors before the data area	*/
+	uint32	bit;			/* Walks the bits of a sector	*/
+	uint32	i;			/* Sector of the bitmap		*/
+	byte	bmbuf[LF_BLKSIZ];	/* One sector of the bitmap	*/
+
+	nbits = sectors + lfiblks;
+	bmsectors = (nbits + LF_BMSECTBITS - 1) / LF_BMSECTBITS;
+	inuse = ibsectors + 1 + bmsectors;
+	if (nbits > LF_BMBITS || inuse >= sectors) {
+		return SYSERR;
+	}
+	dirptr->lfd_vers = format;
+	dirptr->lfd_nblks = sectors;	/* No free lists: these take	*/
+	dirptr->lfd_niblks = lfiblks;	/*   the place of their heads	*/
+	if (lfcwrite(disk, LF_AREA_DIR, 0, (char *)dirptr,
+				sizeof(struct lfdir)) == SYSERR) {
+		return SYSERR;
+	}
+
+	/* The directory, the index area, and the bitmap are in use;	*/
+	/*   every data block and every i-block is free			*/
+
+	for (i = 0; i < bmsectors; i++) {
+		memset((char *)bmbuf, NULLCH, LF_BLKSIZ);
+		for (bit = 0; bit < LF_BMSECTBITS
+			      && i * LF_BMSECTBITS + bit < inuse; bit++) {
+			bmbuf[bit >> 3] |= 1 << (bit & 7);
+		}
+		lfcwrite(disk, lfbmstart(dirptr) + i, 0, (char *)bmbuf,
+						LF_BLKSIZ);
+	}
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * lfscreate  -  Create an initially-empty file system on a disk, with
+ *		   free lists, with a free-space bitmap, or with a bitmap
+ *		   and files laid out in extents
  *------------------------------------------------------------------------
  */
 status	lfscreate (
 	  did32		disk,		/* ID of an open disk device	*/
 	  ibid32	lfiblks,	/* Num. of index blocks on disk	*/
-	  uint32	dsiz		/* Total size of disk in bytes	*/
+	  uint32	dsiz,		/* Total size of disk in bytes	*/
+	  int32		format		/* LF_VERS_LIST, _BITMAP, _EXTENT*/
 	)
 {
 	uint32	sectors;		/* Number of sectors to use	*/
@@ -40,11 +94,30 @@ status	lfscreate (
 	/* Create an initial directory */
 
 	memset((char *)&dir, NULLCH, sizeof(struct lfdir));
+	dir.lfd_fsysid = LFS_ID;	/* Fields lfscheck verifies	*/
+	dir.lfd_allzeros = 0x00000000;
+	dir.lfd_allones = 0xffffffff;
+	dir.lfd_revid = LFS_REVID;
 	dir.lfd_nfiles = 0;
+
+	if (format == LF_VERS_BITMAP || format == LF_VERS_EXTENT) {
+		if (format == LF_VERS_EXTENT) {	/* No index area	*/
+			lfiblks = ibsectors = 0;
+		}
+		retval = lfsbitmap(disk, &dir, format, sectors, lfiblks,
+							ibsectors);
+		lfcsync(disk);
+		close(disk);
+		return retval;
+	} else if (format != LF_VERS_LIST) {
+		return SYSERR;
+	}
+	dir.lfd_vers = LF_VERS_LIST;
 	dbindex= (dbid32)(ibsectors + 1);
 	dir.lfd_dfree = dbindex;
 	dblks = sectors - ibsectors - 1;
-	retval = write(disk,(char *)&dir, LF_AREA_DIR);
+	retval = lfcwrite(disk, LF_AREA_DIR, 0, (char *)&dir,
+						sizeof(struct lfdir));
 	if (retval == SYSERR) {
 		return SYSERR;
 	}
@@ -64,11 +137,15 @@ status	lfscreate (
 	memset((char*)&dblock, NULLCH, LF_BLKSIZ);
 	for (i=0; i<dblks-1; i++) {
 		dblock.lf_nextdb = dbindex + 1;
-		write(disk, (char *)&dblock, dbindex);
+		lfcwrite(disk, dbindex, 0, (char *)&dblock, LF_BLKSIZ);
 		dbindex++;
 	}
 	dblock.lf_nextdb = LF_DNULL;
-	write(disk, (char *)&dblock, dbindex);
+	lfcwrite(disk, dbindex, 0, (char *)&dblock, LF_BLKSIZ);
+
+	/* Write everything back before the disk is closed */
+
+	lfcsync(disk);
 	close(disk);
 	return OK;
 }
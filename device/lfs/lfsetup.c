@@ -2,6 +2,25 @@
 
 #include <xinu.h>
 
+/*------------------------------------------------------------------------
+ * lfibmark  -  Add the current index block of a file to its map of
+ *		  index blocks when it is the next one the map lacks
+ *------------------------------------------------------------------------
+ */
+local	void	lfibmark(
+	  struct lflcblk  *lfptr	/* Pointer to slave file device	*/
+	)
+{
+	uint32	region;			/* Region the i-block covers	*/
+
+	region = lfptr->lfiblock.ib_offset / LF_IDATA;
+	if (region == lfptr->lfibmapped
+	    && lfibmapgrow(lfptr, region + 1) == OK) {
+		lfptr->lfibmap[region] = lfptr->lfinum;
+		lfptr->lfibmapped++;
+	}
+}
+
 /*------------------------------------------------------------------------
  * lfsetup  -  Set a file's index block and data block for the current
  *		 file position (assumes file mutex held)
@@ -19,11 +38,20 @@ status	lfsetup (
 					/*   next index block		*/
 	int32	dindex;			/* Index into array in an index	*/
 					/*   block			*/
+	uint32	region;			/* LF_IDATA bytes of the file	*/
+					/*   that hold the position	*/
+	uint32	known;			/* Closest region the map has	*/
 
 
+	/* Files in the extent format have no index blocks */
+
+	if (Lf_data.lf_dir.lfd_vers == LF_VERS_EXTENT) {
+		return lfxsetup(lfptr);
+	}
+
 	/* Obtain exclusive access to the directory */
 
-	wait(Lf_data.lf_mutex);
+	mutex_lock(Lf_data.lf_mutex);
 
 	/* Get pointers to in-memory directory, file's entry in the	*/
 	/*	directory, and the in-memory index block		*/
@@ -56,19 +84,32 @@ status	lfsetup (
 	 		lfibget(Lf_data.lf_dskdev, ibnum, ibptr);
 		}
 		lfptr->lfinum = ibnum;
+		lfibmark(lfptr);
+	}
 
-	/* Otherwise, if current file position has been moved to an	*/
-	/*   offset before the current index block, start at the	*/
-	/*   beginning of the index list for the file			*/
-
-	} else if (lfptr->lfpos < ibptr->ib_offset) {
+	/* If the current file position lies outside the current index	*/
+	/*   block, go straight to the index block that covers it when	*/
+	/*   the map has it, or else to the last index block the map has	*/
+	/*   (the first of the file if none) when that one is closer	*/
+	/*   than the current index block				*/
 
-		/* Load initial index block for the file (we know that	*/
-		/*	at least one index block exists)		*/
-	
+	if ((lfptr->lfpos & ~LF_IMASK) != ibptr->ib_offset) {
+		region = lfptr->lfpos / LF_IDATA;
+		known = 0;
 		ibnum = ldptr->ld_ilist;
-		lfibget(Lf_data.lf_dskdev, ibnum, ibptr);
-		lfptr->lfinum = ibnum;
+		if (lfptr->lfibmapped > 0) {
+			known = lfptr->lfibmapped - 1;
+			if (known > region) {
+				known = region;
+			}
+			ibnum = lfptr->lfibmap[known];
+		}
+		if (lfptr->lfpos < ibptr->ib_offset
+		    || known * LF_IDATA > ibptr->ib_offset) {
+			lfibget(Lf_data.lf_dskdev, ibnum, ibptr);
+			lfptr->lfinum = ibnum;
+			lfptr->lfdnum = LF_DNULL; /* Invalidate data block */
+		}
 	}
 
 	/* At this point, an index block is in memory, but may cover	*/
@@ -90,6 +131,7 @@ status	lfsetup (
 			lfibget(Lf_data.lf_dskdev, ibnum, ibptr);
 			lfptr->lfinum = ibnum;
 		}
+		lfibmark(lfptr);
 		lfptr->lfdnum = LF_DNULL; /* Invalidate old data block */
 	}
 
@@ -104,11 +146,13 @@ status	lfsetup (
 
 	dnum = lfptr->lfiblock.ib_dba[dindex];
 	if (dnum == LF_DNULL) {		/* Allocate new data block */
-		dnum = lfdballoc((struct lfdbfree *)&lfptr->lfdblock);
+		dnum = lfdballoc((struct lfdbfree *)&lfptr->lfdblock,
+			dindex > 0 ? ibptr->ib_dba[dindex - 1] : LF_DNULL);
 		lfptr->lfiblock.ib_dba[dindex] = dnum;
 		lfptr->lfibdirty = TRUE;
 	} else if ( dnum != lfptr->lfdnum) {
-		read(Lf_data.lf_dskdev, (char *)lfptr->lfdblock, dnum);
+		lfcread(Lf_data.lf_dskdev, dnum, 0, lfptr->lfdblock,
+							LF_BLKSIZ);
 		lfptr->lfdbdirty = FALSE;
 	}
 	lfptr->lfdnum = dnum;
@@ -117,6 +161,6 @@ status	lfsetup (
 	/*   within the data block					*/
 
 	lfptr->lfbyte = &lfptr->lfdblock[lfptr->lfpos & LF_DMASK];
-	signal(Lf_data.lf_mutex);
+	mutex_unlock(Lf_data.lf_mutex);
 	return OK;
 }
@@ -16,9 +16,13 @@ devcall	lfsinit (
 
 	Lf_data.lf_dskdev = LF_DISK_DEV;
 
-	/* Create a mutual exclusion semaphore */
+	/* Create a mutex with priority inheritance */
 
-	Lf_data.lf_mutex = semcreate(1);
+	Lf_data.lf_mutex = mutex_create(devptr->dvname);
+
+	/* Start with an empty block cache */
+
+	lfcinit();
 
 	/* Zero directory area (for debugging) */
 
@@ -80,16 +80,23 @@ devcall	lfsopen (
 	/* Obtain copy of directory if not already present in memory	*/
 
 	dirptr = &Lf_data.lf_dir;
-	wait(Lf_data.lf_mutex);
+	mutex_lock(Lf_data.lf_mutex);
 	if (! Lf_data.lf_dirpresent) {
-	    retval = read(Lf_data.lf_dskdev,(char *)dirptr,LF_AREA_DIR);
+	    retval = lfcread(Lf_data.lf_dskdev, LF_AREA_DIR, 0,
+				(char *)dirptr, sizeof(struct lfdir));
 	    if (retval == SYSERR ) {
-		signal(Lf_data.lf_mutex);
+		mutex_unlock(Lf_data.lf_mutex);
 		return SYSERR;
 	    }
 	    if (lfscheck(dirptr) == SYSERR ) {
 		kprintf("Disk does not contain a Xinu file system\n");
-		signal(Lf_data.lf_mutex);
+		mutex_unlock(Lf_data.lf_mutex);
+		return SYSERR;
+	    }
+	    if (lfhasbitmap(dirptr)
+		&& lfbmload() == SYSERR) {
+		kprintf("Cannot load the free-space bitmap\n");
+		mutex_unlock(Lf_data.lf_mutex);
 		return SYSERR;
 	    }
 	    Lf_data.lf_dirpresent = TRUE;
@@ -119,7 +126,7 @@ devcall	lfsopen (
 
 	if (! found) {
 		if (mbits & LF_MODE_O) {	/* File *must* exist	*/
-			signal(Lf_data.lf_mutex);
+			mutex_unlock(Lf_data.lf_mutex);
 			return SYSERR;
 		}
 
@@ -128,7 +135,7 @@ devcall	lfsopen (
 		/* Verify that space remains in the directory */
 
 		if (dirptr->lfd_nfiles >= LF_NUM_DIR_ENT) {
-			signal(Lf_data.lf_mutex);
+			mutex_unlock(Lf_data.lf_mutex);
 			return SYSERR;
 		}
 
@@ -146,7 +153,7 @@ devcall	lfsopen (
 	/* Case #2 - file is in directory (i.e., already exists)	*/
 
 	} else if (mbits & LF_MODE_N) {		/* File must not exist	*/
-			signal(Lf_data.lf_mutex);
+			mutex_unlock(Lf_data.lf_mutex);
 			return SYSERR;
 	}
 
@@ -170,7 +177,16 @@ devcall	lfsopen (
 	/* Neither index block nor data block are initially valid	*/
 
 	lfptr->lfinum    = LF_INULL;
+	lfptr->lfibmapped = 0;
 	lfptr->lfdnum    = LF_DNULL;
+	lfptr->lfxlen    = 0;
+
+	/* Size the map of index blocks to the file; without the memory	*/
+	/*	the file is still usable, and seeks walk the i-blocks	*/
+
+	if (Lf_data.lf_dir.lfd_vers != LF_VERS_EXTENT) {
+		lfibmapgrow(lfptr, ldptr->ld_size / LF_IDATA + 1);
+	}
 
 	/* Initialize byte pointer to address beyond the end of the	*/
 	/*	buffer (i.e., invalid pointer triggers setup)		*/
@@ -179,7 +195,7 @@ devcall	lfsopen (
 	lfptr->lfibdirty = FALSE;
 	lfptr->lfdbdirty = FALSE;
 
-	signal(Lf_data.lf_mutex);
+	mutex_unlock(Lf_data.lf_mutex);
 
 	return lfptr->lfdev;
 }
@@ -33,12 +33,27 @@ status	lftruncate (
 	}
 	lfptr->lfpos = 0;
 	lfptr->lfinum = LF_INULL;
+	lfptr->lfibmapped = 0;
 	lfptr->lfdnum = LF_DNULL;
 	lfptr->lfbyte = &lfptr->lfdblock[LF_BLKSIZ];
 
-	/* Obtain ID of first index block on free list */
+	/* A file in the extent format frees its extent tree */
 
-	ifree = Lf_data.lf_dir.lfd_ifree;
+	if (Lf_data.lf_dir.lfd_vers == LF_VERS_EXTENT) {
+		lfxtruncate(lfptr);
+		ldptr->ld_size = 0;
+		Lf_data.lf_dirdirty = TRUE;
+		return OK;
+	}
+
+	/* Obtain ID of first index block on free list; the bitmap	*/
+	/*   format has no list, and lfd_ifree holds lfd_niblks	*/
+
+	if (lfhasbitmap(&Lf_data.lf_dir)) {
+		ifree = LF_INULL;
+	} else {
+		ifree = Lf_data.lf_dir.lfd_ifree;
+	}
 
 	/* Record file's first i-block and clear directory entry */
 
@@ -84,9 +99,14 @@ status	lftruncate (
 			iblock.ib_next = ifree;
 		}
 
-		/* Write cleared i-block back to disk */
+		/* Write cleared i-block back to disk, or in the bitmap	*/
+		/*	format just mark it free			*/
 
-		lfibput(Lf_data.lf_dskdev, nextib, &iblock);
+		if (lfhasbitmap(&Lf_data.lf_dir)) {
+			lfbmfree(Lf_data.lf_dir.lfd_nblks + nextib);
+		} else {
+			lfibput(Lf_data.lf_dskdev, nextib, &iblock);
+		}
 	}
 
 	/* Last index block on the file list now points to first node	*/
@@ -94,7 +114,9 @@ status	lftruncate (
 	/*   point to the first index block on the file list, the	*/
 	/*   entire set of index blocks will be on the free list	*/
 
-	Lf_data.lf_dir.lfd_ifree = firstib;
+	if (!lfhasbitmap(&Lf_data.lf_dir)) {
+		Lf_data.lf_dir.lfd_ifree = firstib;
+	}
 
 	/* Indicate that directory has changed and return */
 
@@ -8,9 +8,41 @@
 
 
 #define CLKTICKS_PER_SEC  1000	/* clock timer resolution		*/
+#define	CLKINTV		1193	/* chip counts per tick (1.193 MHz)	*/
+#define	CLKMAXIDLE	(0xffff / CLKINTV) /* most ticks one count spans*/
 
 extern	uint32	clktime;	/* current time in secs since boot	*/
 extern  uint32	count1000;        /* ms since last clock tick             */
 
-extern	qid16	sleepq;		/* queue for sleeping processes		*/
-extern	uint32	preempt;	/* preemption counter			*/
+extern	qid16	sleepq;		/* delta list of sleeping processes	*/
+
+/* Sleeping processes normally wait on a hierarchical timing wheel of	*/
+/*   SLPLEVELS levels of SLPSLOTS queues each, one after another in	*/
+/*   queuetab; the delta list sleepq is kept for comparison		*/
+
+#define	SLPBITS		6		/* log2 of SLPSLOTS		*/
+#define	SLPSLOTS	(1 << SLPBITS)	/* queues per wheel level	*/
+#define	SLPLEVELS	6		/* enough for any 31-bit delay	*/
+
+#define	SLP_WHEEL	0		/* sleepkind: timing wheel	*/
+#define	SLP_DELTA	1		/* sleepkind: delta list	*/
+
+#define	sleepslot(l, s)	(sleepwheel + 2 * ((l) * SLPSLOTS + (s)))
+
+extern	qid16	sleepwheel;	/* first queue of the timing wheel	*/
+extern	uint32	sleepbase;	/* tick the clock handler does next	*/
+extern	int32	sleepkind;	/* sleep queue design in use		*/
+extern	uint32	sleepcyc;	/* cycles spent on sleepers per tick	*/
+extern	uint32	sleepmax;	/*   ... and most on a single tick	*/
+extern	uint32	sleepopcyc;	/* cycles spent inserting and removing	*/
+extern	uint32	sleepops;	/* sleepers inserted and removed	*/
+
+/* While nothing but one process (or the null process) can run, the	*/
+/*   clock chip is put in one-shot mode up to the next sleep deadline	*/
+
+extern	uint32	clktickless;	/* ticks the one-shot spans, 0 if not	*/
+extern	bool8	clkskip;	/* next clock interrupt was accounted	*/
+extern	uint32	clkticks;	/* ticks elapsed since boot		*/
+extern	uint32	clkirqs;	/* clock interrupts taken since boot	*/
+
+extern	uint32	tschz;		/* TSC rate measured at boot, 0 if none	*/
@@ -0,0 +1,97 @@
+/* cpu.h - processor feature flags and control register bits */
+
+/* Feature flags reported by CPUID leaf 1 in EDX */
+
+#define	CPUID_PSE	0x00000008	/* 4 MB pages (CR4.PSE)		*/
+#define	CPUID_TSC	0x00000010	/* Time stamp counter (rdtsc)	*/
+#define	CPUID_APIC	0x00000200	/* On-chip local APIC		*/
+#define	CPUID_PGE	0x00002000	/* Global pages (CR4.PGE)	*/
+#define	CPUID_FXSR	0x01000000	/* fxsave and fxrstor		*/
+#define	CPUID_SSE	0x02000000	/* SSE instructions		*/
+
+/* Control register 0 bits */
+
+#define	CR0_MP		0x00000002	/* wait honors CR0.TS		*/
+#define	CR0_EM		0x00000004	/* Emulate the FPU (trap on it)	*/
+#define	CR0_TS		0x00000008	/* Task switched: FPU use traps	*/
+#define	CR0_NE		0x00000020	/* FPU errors raise exception 16*/
+#define	CR0_WP		0x00010000	/* Kernel honors read-only pages	*/
+#define	CR0_PG		0x80000000	/* Paging enabled		*/
+
+/* Control register 4 bits */
+
+#define	CR4_PSE		0x00000010	/* Page size extensions		*/
+#define	CR4_PGE		0x00000080	/* Page global enable		*/
+#define	CR4_OSFXSR	0x00000200	/* fxsave saves the SSE state	*/
+#define	CR4_OSXMMEXCPT	0x00000400	/* SSE errors raise exception 19*/
+
+extern	uint32	cpufeatures;	/* CPUID leaf 1 EDX, read at boot	*/
+
+/* The FPU and SSE registers are switched lazily: a process gets its	*/
+/*   saved state back when its first FPU instruction traps (#NM); each	*/
+/*   processor records the process whose state it holds in cpfpuowner	*/
+
+#define	FPU_SAVESIZE	512		/* fxsave area, 16-byte aligned	*/
+
+extern	uint32	fpuloads;	/* states loaded on an #NM trap		*/
+
+/* Index of the highest (bsr) or lowest (bsf) bit set in a nonzero word	*/
+
+static inline uint32 HighBit(uint32 word)
+{
+	uint32	bit;
+	asm("bsrl %1, %0" : "=r"(bit) : "rm"(word));
+	return bit;
+}
+
+static inline uint32 LowBit(uint32 word)
+{
+	uint32	bit;
+	asm("bsfl %1, %0" : "=r"(bit) : "rm"(word));
+	return bit;
+}
+
+/* Task state segment (hardware task switching is only used to run	*/
+/*   the page fault handler on a stack of its own); every processor has	*/
+/*   a pair in its cputab entry, and a GDT of its own that points the	*/
+/*   selectors below at them					*/
+
+struct	tss	{
+	uint32	tss_link;	/* Selector of the interrupted task	*/
+	uint32	tss_esp0;
+	uint32	tss_ss0;
+	uint32	tss_esp1;
+	uint32	tss_ss1;
+	uint32	tss_esp2;
+	uint32	tss_ss2;
+	uint32	tss_cr3;	/* Loaded, but never saved, by the CPU	*/
+	uint32	tss_eip;
+	uint32	tss_eflags;
+	uint32	tss_eax;
+	uint32	tss_ecx;
+	uint32	tss_edx;
+	uint32	tss_ebx;
+	uint32	tss_esp;
+	uint32	tss_ebp;
+	uint32	tss_esi;
+	uint32	tss_edi;
+	uint32	tss_es;
+	uint32	tss_cs;
+	uint32	tss_ss;
+	uint32	tss_ds;
+	uint32	tss_fs;
+	uint32	tss_gs;
+	uint32	tss_ldt;
+	uint16	tss_trap;
+	uint16	tss_iomap;	/* Past the limit: no I/O bitmap	*/
+};
+
+#define	TSS_MAIN	0x20	/* GDT selector of the kernel's task	*/
+#define	TSS_PF		0x28	/* GDT selector of the page fault task	*/
+#define	KSEG_CPU	0x30	/* GDT selector of the per-CPU segment,	*/
+				/*   kept in %fs: the cputab entry	*/
+#define	PFSTK		8192	/* Stack size of the page fault task	*/
+
+#define	EFLAGS_IF	0x00000200	/* Interrupts enabled		*/
+#define	EFLAGS_NT	0x00004000	/* Nested task			*/
+
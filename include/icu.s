@@ -13,3 +13,17 @@
 	.set	IMR2,ICU2 + 1	/* Interrupt Mask Register for #2	*/
 
 	.set	EOI,0x20	/* non-specific end of interrupt	*/
+
+/* SENDEOI - acknowledge an interrupt at the local APIC when the APICs	*/
+/*	deliver interrupts (lapiceoi set), else at the master 8259	*/
+
+	.macro	SENDEOI
+	movl	lapiceoi,%eax
+	testl	%eax,%eax
+	jz	1f
+	movl	$0,(%eax)	/* Memory write, no port I/O		*/
+	jmp	2f
+1:	movb	$EOI,%al
+	outb	%al,$OCW1_2
+2:
+	.endm
@@ -19,6 +19,8 @@ typedef	int32	did32;		/* device ID				*/
 typedef	int16	pri16;		/* process priority			*/
 typedef	uint32	umsg32;		/* message passed among processes	*/
 typedef	int32	bpid32;		/* buffer pool ID			*/
+typedef	int32	cid32;		/* object cache ID			*/
+typedef	int32	mxid32;		/* mutex ID				*/
 typedef	byte	bool8;		/* Boolean type				*/
 typedef	uint32	intmask;	/* saved interrupt mask			*/
 typedef	int32	ibid32;		/* index block ID (used in file system)	*/
@@ -54,8 +56,6 @@ typedef	int32	status;		/* returned status value (OK/SYSERR)	*/
 #define	EOF	(-2)		/* End-of-file (usually from read)	*/
 #define	TIMEOUT	(-3)		/* system call timed out		*/
 
-extern	qid16	readylist;	/* global ID for list of ready processes*/
-
 #define	MINSTK	400		/* minimum stack size in bytes		*/
 
 #define	CONTEXT	64		/* bytes in a function call context on	*/
@@ -26,6 +26,24 @@
 /* i-block number for a list of free i-blocks and a data block number	*/
 /* of the first data block on a list of free data blocks.		*/
 /*									*/
+/*   A file system in the bitmap format (lfd_vers LF_VERS_BITMAP) has	*/
+/* no free lists: a bitmap placed after the index area holds one bit	*/
+/* for each sector, then one bit for each i-block, set when the block	*/
+/* is in use.  The bitmap is kept in memory while the file system is	*/
+/* open, and the data area starts after it.  The directory keeps the	*/
+/* list layout; the number of sectors and of i-blocks take the place	*/
+/* of the two free-list heads.						*/
+/*									*/
+/*   The extent format (LF_VERS_EXTENT) keeps free space in a bitmap	*/
+/* as well, but has no index area: ld_ilist names the root of a tree	*/
+/* of extent nodes, each a data-area sector.  A leaf holds runs of	*/
+/* consecutive disk blocks (extents) in file order; an interior node	*/
+/* holds the first file block and the node of each subtree.  A file	*/
+/* grows only at its end, so new entries always go to the rightmost	*/
+/* path, and the root stays in place by moving its entries down a	*/
+/* level when it fills.  The directory block has no room for extents,	*/
+/* so even a file of a single extent has its root in its own sector.	*/
+/*									*/
 /************************************************************************/
 
 #ifndef	Nlfl
@@ -66,6 +84,19 @@
 #define	LF_AREA_IB	1		/* First sector of i-blocks	*/
 #define	LF_AREA_DIR	0		/* First sector of directory	*/
 
+/* Formats of free space, kept in lfd_vers */
+
+#define	LF_VERS_LIST	0		/* Free lists of blocks		*/
+#define	LF_VERS_BITMAP	1		/* Bitmap of the blocks in use	*/
+#define	LF_VERS_EXTENT	2		/* Bitmap, and files of extents	*/
+
+#define	lfhasbitmap(dirptr)	((dirptr)->lfd_vers == LF_VERS_BITMAP \
+				|| (dirptr)->lfd_vers == LF_VERS_EXTENT)
+
+#define	LF_BMBYTES	4096		/* Largest bitmap: 32768 bits	*/
+#define	LF_BMBITS	(LF_BMBYTES * 8)
+#define	LF_BMSECTBITS	(LF_BLKSIZ * 8)	/* Bits in a sector of bitmap	*/
+
 /* Structure of an index block on disk */
 
 struct	lfiblk		{		/* Format of index block	*/
@@ -75,9 +106,28 @@ struct	lfiblk		{		/* Format of index block	*/
 	dbid32		ib_dba[LF_IBLEN];/* Ptrs to data blocks indexed	*/
 };
 
+/* Extent of a file, and node of the extent tree on disk */
+
+struct	lfextent	{		/* A run of disk blocks		*/
+	uint32		ex_fblk;	/* First file block it holds	*/
+	dbid32		ex_start;	/* First disk block, or the	*/
+					/*   node of a subtree		*/
+	uint32		ex_len;		/* Blocks in the run (leaf only)*/
+};
+
+#define	LF_XNENT	42		/* Entries in an extent node	*/
+#define	LF_XMAXLVL	8		/* Deepest extent tree		*/
+
+struct	lfxnode		{		/* Node of an extent tree	*/
+	int32		xn_level;	/* 0 for a leaf			*/
+	int32		xn_count;	/* Entries in use		*/
+	struct	lfextent xn_ext[LF_XNENT];/* Entries by file block	*/
+};
+
 /* File System ID */
 
 #define	LFS_ID		0x58696E75	/* ID for Xinu Local File System*/
+#define	LFS_REVID	0x756E6958	/* LFS_ID in reverse byte order	*/
 
 /* Conversion functions below assume 7 index blocks per disk block */
 
@@ -90,6 +140,10 @@ struct	lfiblk		{		/* Format of index block	*/
 
 #define	ib2disp(ib)	(((ib)%7)*sizeof(struct lfiblk))
 
+/* First sector of the bitmap, which follows the index area		*/
+
+#define	lfbmstart(dirptr)	ib2sect((dirptr)->lfd_niblks)
+
 
 /* Structure used in each directory entry for the local file system */
 
@@ -117,24 +171,43 @@ struct	lfdir	{			/* Entire directory on disk	*/
 	int16	lfd_subvers;		/* File system subversion	*/
 	uint32	lfd_allzeros;		/* All 0 bits			*/
 	uint32	lfd_allones;		/* All 1 bits			*/
-	dbid32	lfd_dfree;		/* List of free d-blocks on disk*/
-	ibid32	lfd_ifree;		/* List of free i-blocks on disk*/
+	union	{			/* Free space, by lfd_vers	*/
+	  struct {			/* LF_VERS_LIST			*/
+	    dbid32 lfd_dfree;		/* List of free d-blocks on disk*/
+	    ibid32 lfd_ifree;		/* List of free i-blocks on disk*/
+	  };
+	  struct {			/* LF_VERS_BITMAP and _EXTENT	*/
+	    uint32 lfd_nblks;		/* Sectors, with bits 0 up	*/
+	    uint32 lfd_niblks;		/* I-blocks, with bits after	*/
+	  };				/*   those of the sectors	*/
+	};
 	int32	lfd_nfiles;		/* Current number of files	*/
 	struct	ldentry lfd_files[LF_NUM_DIR_ENT]; /* Set of files	*/
 	uint32	lfd_revid;		/* fsysid in reverse byte order	*/
 };
 #pragma pack()
 
+/* The directory is read and written as one disk block: fail to compile	*/
+/*   if it ever outgrows one						*/
+
+typedef	char	lfdirfits[sizeof(struct lfdir) <= LF_BLKSIZ ? 1 : -1];
+
 /* Global data used by local file system */
 
 struct	lfdata	{			/* Local file system data	*/
 	did32	lf_dskdev;		/* Device ID of disk to use	*/
-	sid32	lf_mutex;		/* Mutex for the directory and	*/
+	mxid32	lf_mutex;	/* Mutex for the directory and	*/
 					/*   index/data free lists	*/
 	struct	lfdir	lf_dir;		/* In-memory copy of directory	*/
 	bool8	lf_dirpresent;		/* True when directory is in	*/
 					/*   memory (1st file is open)	*/
 	bool8	lf_dirdirty;		/* Has the directory changed?	*/
+	uint32	lf_bmdirty;		/* Bitmap format: sectors of the*/
+					/*   bitmap changed, one bit each*/
+	uint32	lf_bmrotor;		/* Bit where the next search for*/
+					/*   a free data block starts	*/
+	byte	lf_bitmap[LF_BMBYTES];	/* In-memory copy of the bitmap	*/
+	uint32	lf_ibgets;		/* Index blocks fetched so far	*/
 };
 
 /* Control block for local file pseudo-device */
@@ -143,7 +216,7 @@ struct	lflcblk	{			/* Local file control block	*/
 					/*   (one for each open file)	*/
 	byte	lfstate;		/* Is entry free or used	*/
 	did32	lfdev;			/* Device ID of this device	*/
-	sid32	lfmutex;		/* Mutex for this file		*/
+	mxid32	lfmutex;	/* Mutex for this file		*/
 	struct	ldentry	*lfdirptr;	/* Ptr to file's entry in the	*/
 					/*   in-memory directory	*/
 	int32	lfmode;			/* Mode (read/write/both)	*/
@@ -164,11 +237,53 @@ struct	lflcblk	{			/* Local file control block	*/
 					/*   outside lfdblock		*/
 	bool8	lfibdirty;		/* Has lfiblock changed?	*/
 	bool8	lfdbdirty;		/* Has lfdblock changed?	*/
+	uint32	lfxfblk;		/* Extent format: last extent	*/
+	dbid32	lfxstart;		/*   found, as in lfextent, or	*/
+	uint32	lfxlen;			/*   lfxlen 0 if none		*/
+	ibid32	*lfibmap;		/* I-block of each LF_IDATA	*/
+					/*   bytes of the file, filled	*/
+					/*   in as the i-block list is	*/
+					/*   walked, or NULL		*/
+	uint32	lfibmapmax;		/* Entries lfibmap has room for	*/
+	uint32	lfibmapped;		/* Entries of lfibmap known	*/
 };
 
 extern	struct	lfdata	Lf_data;
 extern	struct	lflcblk	lfltab[];
 
+/* Block cache shared by all files between the file system and the	*/
+/*   disk: blocks are found by hashing, the least recently used one is	*/
+/*   replaced, and changed blocks are written back when replaced or	*/
+/*   synced								*/
+
+#ifndef	LFC_NBUF
+#define	LFC_NBUF	64		/* Blocks held in the cache	*/
+#endif
+#define	LFC_NHASH	32		/* Hash chains (a power of two)	*/
+
+struct	lfcbuf	{			/* One cached disk block	*/
+	did32	cb_disk;		/* Disk the block comes from	*/
+	dbid32	cb_blk;			/* Block number or LF_DNULL	*/
+	bool8	cb_dirty;		/* Changed since read or written*/
+	int32	cb_hnext;		/* Next buffer on the hash chain*/
+	int32	cb_newer;		/* Neighbors on the LRU list,	*/
+	int32	cb_older;		/*   or -1 at either end	*/
+	char	cb_data[LF_BLKSIZ];	/* Contents of the block	*/
+};
+
+struct	lfcache	{			/* The block cache		*/
+	mxid32	lc_mutex;		/* Mutex for the cache		*/
+	int32	lc_hash[LFC_NHASH];	/* First buffer of each chain	*/
+	int32	lc_newest;		/* Most recently used buffer	*/
+	int32	lc_oldest;		/* Least recently used buffer	*/
+	uint32	lc_hits;		/* Blocks found in the cache	*/
+	uint32	lc_misses;		/* Blocks that had to be loaded	*/
+	uint32	lc_writebacks;		/* Changed blocks written	*/
+	struct	lfcbuf	lc_buf[LFC_NBUF];
+};
+
+extern	struct	lfcache	Lf_cache;
+
 /* Control functions */
 
 #define	LF_CTL_DEL	F_CTL_DEL	/* Delete a file		*/
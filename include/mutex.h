@@ -0,0 +1,32 @@
+/* mutex.h - isbadmutex */
+
+#ifndef	NMUTEX
+#define	NMUTEX		32	/* Number of mutexes, if not defined	*/
+#endif
+
+#define	MXNMLEN		12	/* Length of a mutex name		*/
+
+/* Mutex state definitions */
+
+#define	MX_FREE	0		/* Mutex table entry is available	*/
+#define	MX_USED	1		/* Mutex table entry is in use		*/
+
+/* Mutex table entry; the owner runs at the priority of the highest	*/
+/*   priority process waiting, and so on down a chain of owners that	*/
+/*   wait on other mutexes					*/
+
+struct	mutent	{
+	byte	mxstate;	/* Whether entry is MX_FREE or MX_USED	*/
+	pid32	mxowner;	/* Process holding the mutex, or -1	*/
+	qid16	mxqueue;	/* Processes waiting, highest priority	*/
+				/*   first				*/
+	mxid32	mxnext;		/* Next mutex held by the owner, or -1	*/
+	char	mxname[MXNMLEN];/* Name (for debugging)			*/
+	uint32	mxlocks;	/* Times the mutex was locked		*/
+	uint32	mxwaits;	/* Times a locker had to wait		*/
+	uint64	mxmaxwait;	/* Longest wait, in cpustamp units	*/
+};
+
+extern	struct	mutent mutab[];
+
+#define	isbadmutex(m)	((int32)(m) < 0 || (m) >= NMUTEX)
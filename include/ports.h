@@ -21,7 +21,8 @@ struct	ptentry	{			/* Entry in the port table	*/
 	struct	ptnode	*pttail;	/* Tail of message list		*/
 };
 
-extern	struct	ptnode	*ptfree;	/* List of free nodes		*/
+extern	cid32	ptcache;		/* Cache of message nodes	*/
+extern	int32	ptmaxmsgs;		/* Max. nodes allocated at once	*/
 extern	struct	ptentry	porttab[];	/* Port table			*/
 extern	int32	ptnextid;		/* Next port ID to try when	*/
 					/*   looking for a free slot	*/
@@ -16,6 +16,7 @@
 #define	PR_SUSP		5	/* Process is suspended			*/
 #define	PR_WAIT		6	/* Process is on semaphore queue	*/
 #define	PR_RECTIM	7	/* Process is receiving with timeout	*/
+#define	PR_MUTEX	8	/* Process is on a mutex queue		*/
 
 /* Miscellaneous process definitions */
 
@@ -28,6 +29,16 @@
 #define	INITPRIO	20	/* Initial process priority		*/
 #define	INITRET		userret	/* Address to which process returns	*/
 
+/* Scheduling classes: fixed priority, or earliest deadline first for	*/
+/*   periodic real-time processes, which run before all others		*/
+
+#define	PC_PRIO		0	/* Priority and round robin		*/
+#define	PC_EDF		1	/* Earliest deadline first		*/
+#define	EDFPRIO		32767	/* prprio of EDF processes		*/
+#define	EDFMAXUTIL	900000	/* Most CPU share (ppm) EDF may reserve	*/
+
+extern	uint32	edfutil;	/* CPU share (ppm) EDF has reserved	*/
+
 /* Inline code to check process ID (assumes interrupts are disabled)	*/
 
 #define	isbadpid(x)	( ((pid32)(x) < 0) || \
@@ -38,6 +49,11 @@
 
 #define NDESC		5	/* must be odd to make procent 4N bytes	*/
 
+/* Number of segregated size classes of a process heap (see vm.h), at	*/
+/*   most 32 so that one word can tell which lists are non-empty	*/
+
+#define	HEAP_NCLASS	32
+
 /* Definition of the process table (multiple of 32 bits) */
 
 struct procent {		/* Entry in the process table		*/
@@ -54,13 +70,63 @@ struct procent {		/* Entry in the process table		*/
 	int16	prdesc[NDESC];	/* Device descriptors for process	*/
 
 	uint32  phypgdir; /* Physical page dir*/
-	uint32 freelistptr;
+	uint32	freelists[HEAP_NCLASS]; /* Heads of the heap free lists	*/
+	uint32	freemap;	/* Bit c set: freelists[c] not empty	*/
 	uint32 maxheap;
+
+	/* CPU accounting, in TSC cycles or clock ticks (see cpustamp)	*/
+
+	uint64	prusertime;	/* Time run outside interrupt handlers	*/
+	uint64	prkerntime;	/* Time run in interrupt handlers	*/
+	uint64	prwaittime;	/* Time spent on the ready queue	*/
+	uint64	prreadyat;	/* When it last went on the ready queue	*/
+	uint32	prvolsw;	/* Switched out because it blocked	*/
+	uint32	prinvolsw;	/* Switched out while still ready	*/
+	uint32	printr;		/* Interrupt handlers it is inside of	*/
+	char	*prfpu;		/* Saved FPU/SSE state, NULL until the	*/
+				/*   process first uses the FPU		*/
+
+	/* Deadline scheduling (PC_EDF only), in clock ticks		*/
+
+	uint32	prclass;	/* PC_PRIO or PC_EDF			*/
+	uint32	prperiod;	/* Time between job releases		*/
+	uint32	prbudget;	/* CPU time each job may use		*/
+	uint32	prreldl;	/* Deadline relative to the release	*/
+	uint32	prdensity;	/* Budget over min(period, deadline),	*/
+				/*   in parts per million		*/
+	uint32	prdeadline;	/* Absolute deadline of the current job	*/
+	uint32	prrelease;	/* Release time of the next job		*/
+	uint32	prleft;		/* Budget the current job has left	*/
+	uint32	prjobs;		/* Jobs completed			*/
+	uint32	prmisses;	/* Jobs completed after their deadline	*/
+	uint32	proverruns;	/* Jobs stopped for exceeding the budget*/
+
+	/* Mutexes: prprio is the larger of prbaseprio and the priority	*/
+	/*   of the processes waiting on the mutexes the process holds	*/
+
+	pri16	prbaseprio;	/* Priority set by create or chprio	*/
+	mxid32	prmutex;	/* Mutex on which process waits		*/
+	mxid32	prheld;		/* First mutex it holds, or -1		*/
+	uint64	prblockat;	/* When it blocked on prmutex		*/
+
+	/* Multiprocessing						*/
+
+	int32	prcpu;		/* Processor it runs on, or last ran on	*/
+				/*   (whose ready queue it waits on)	*/
+	uint32	prreq;		/* PRQ_KILL or PRQ_SUSP asked of it	*/
+				/*   while it ran on another processor	*/
 };
 
+#define	PRQ_KILL	0x1	/* prreq: kill it where it runs		*/
+#define	PRQ_SUSP	0x2	/* prreq: suspend it where it runs	*/
+
 /* Marker for the top of a process stack (used to help detect overflow)	*/
 #define	STACKMAGIC	0x0A0AAAA9
 
 extern	struct	procent proctab[];
 extern	int32	prcount;	/* Currently active processes		*/
-extern	pid32	currpid;	/* Currently executing process		*/
+
+/* The process running on this processor is kept in its cputab entry	*/
+/*   (see cpucurrpid in smp.h)						*/
+
+#define	currpid		cpucurrpid()
@@ -2,6 +2,15 @@
 extern	status	addargs(pid32, int32, int32[], int32,char *, void *);
 
 
+/* in file apic.c */
+extern	void	apicinit(void);
+extern	void	ioapicroute(uint32, uint32);
+extern	void	lapictick(void);
+extern	bool8	lapicpending(void);
+extern	void	lapiconeshot(uint32);
+extern	uint32	lapicwake(bool8, uint32);
+extern	void	lapicstart(void);
+
 /* in file ascdate.c */
 extern	status	ascdate(uint32, char *);
 
@@ -16,6 +25,11 @@ extern	uint32	clkcount(void);
 
 /* in file clkhandler.c */
 extern	interrupt clkhandler(void);
+extern	void	clkadvance(uint32);
+
+/* in file clkidle.c */
+extern	void	clkstop(void);
+extern	void	clkwake(bool8);
 
 /* in file clkinit.c */
 extern	void	clkinit(void);
@@ -29,11 +43,22 @@ extern	syscall	close(did32);
 /* in file control.c */
 extern	syscall	control(did32, int32, int32, int32);
 
+/* in file cputime.c */
+extern	uint64	cpustamp(void);
+extern	uint64	cpucharge(void);
+extern	void	cpuclear(struct procent *);
+extern	void	intrenter(void);
+extern	void	intrexit(void);
+
 /* in file create.c */
 extern	pid32	create(void *, uint32, pri16, char *, uint32, ...);
+extern	pid32	createargs(void *, uint32, pri16, char *, uint32, uint32 *);
+extern	pid32	newpid(void);
 
 /* in file ctxsw.S */
 extern	void	ctxsw(void *, void *, void *);
+extern	status	forkctx(void *, pid32);
+extern	void	procstart(void);
 
 /* in file exit.c */
 extern	void	exit(void);
@@ -41,10 +66,19 @@ extern	void	exit(void);
 /* in file kprintf.c */
 extern int console_init(void);
 
+/* in file edf.c */
+extern	pid32	create_rt(void *, uint32, uint32, uint32, uint32, char *,
+			uint32, ...);
+extern	syscall	rtwait(void);
+extern	void	edftick(void);
+extern	void	edffree(pid32);
+
 /* in file evec.c */
 extern	int32	initevec(void);
 extern	int32	set_evec(uint32, uint32);
 extern	void	trap(int32, long *);
+extern	void	_8259_setirmask(void);
+extern	void	tssinit(int32);
 
 /* in file exception.c */
 extern  void exception(int32, int32*);
@@ -52,9 +86,20 @@ extern  void exception(int32, int32*);
 /* in file freebuf.c */
 extern	syscall	freebuf(char *);
 
+/* in file fork.c */
+extern	pid32	fork(void);
+
 /* in file freemem.c */
 extern	syscall	freemem(char *, uint32);
 
+/* in file fpu.c */
+extern	void	fpuinit(void);
+extern	void	fpucpuinit(void);
+extern	void	fputrap(void);
+extern	void	fpuswitch(pid32);
+extern	status	fpufork(pid32);
+extern	void	fpufree(pid32);
+
 /* in file getbuf.c */
 extern	char	*getbuf(bpid32);
 
@@ -104,6 +149,11 @@ extern	status	insertd(pid32, qid16, int32);
 
 /* in file intr.S */
 extern	uint16	getirmask(void);
+extern	void	idlewait(void);
+extern	void	Xpftask(void);
+extern	void	Xfpu(void);
+extern	void	Xipi(void);
+extern	void	Xspurious(void);
 
 /* in file intutils.S */
 extern	intmask	disable(void);
@@ -121,12 +171,33 @@ extern	syscall	kill(pid32);
 /* in file lexan.c */
 extern	int32	lexan(char *, int32, char *, int32 *, int32 [], int32 []);
 
+/* in file lfbitmap.c */
+extern	status	lfbmload(void);
+extern	status	lfbmsync(void);
+extern	dbid32	lfbmdalloc(dbid32);
+extern	ibid32	lfbmialloc(void);
+extern	void	lfbmfree(uint32);
+
+/* in file lfcache.c */
+extern	void	lfcinit(void);
+extern	status	lfcread(did32, dbid32, uint32, char *, uint32);
+extern	status	lfcwrite(did32, dbid32, uint32, char *, uint32);
+extern	status	lfcsync(did32);
+
+/* in file lfextent.c */
+extern	status	lfxsetup(struct lflcblk *);
+extern	void	lfxtruncate(struct lflcblk *);
+
 /* in file lfibclear.c */
 extern	void	lfibclear(struct lfiblk *, int32);
 
 /* in file lfibget.c */
 extern	void	lfibget(did32, ibid32, struct lfiblk *);
 
+/* in file lfibmap.c */
+extern	status	lfibmapgrow(struct lflcblk *, uint32);
+extern	void	lfibmapfree(struct lflcblk *);
+
 /* in file lfibput.c */
 extern	status	lfibput(did32, ibid32, struct lfiblk *);
 
@@ -134,7 +205,7 @@ extern	status	lfibput(did32, ibid32, struct lfiblk *);
 extern	status	lfdbfree(did32, dbid32);
 
 /* in file lfdballoc.c */
-extern	dbid32	lfdballoc(struct lfdbfree *);
+extern	dbid32	lfdballoc(struct lfdbfree *, dbid32);
 
 /* in file lfflush.c */
 extern	status	lfflush(struct lflcblk *);
@@ -173,7 +244,7 @@ extern	devcall	lflwrite(struct dentry *, char *, int32);
 extern	status	lfscheck(struct lfdir *);
 
 /* in file lfscreate.c */
-extern  status  lfscreate(did32, ibid32, uint32);
+extern  status  lfscreate(did32, ibid32, uint32, int32);
 
 /* in file lfsinit.c */
 extern	devcall	lfsinit(struct dentry *);
@@ -209,6 +280,9 @@ extern	devcall	lpwrite(struct dentry *, char *, int32);
 extern	void	markinit(void);
 extern	status	mark(int32 *);
 
+/* in file meminit.c */
+extern	void	setcpusegs(int32);
+
 /* in file memcpy.c */
 extern	void	*memcpy(void *, const void *, int32);
 
@@ -221,6 +295,15 @@ extern  void    *memset(void *, const int, int32);
 /* in file mkbufpool.c */
 extern	bpid32	mkbufpool(int32, int32);
 
+/* in file mutex.c */
+extern	void	mutexinit(void);
+extern	mxid32	mutex_create(char *);
+extern	syscall	mutex_delete(mxid32);
+extern	syscall	mutex_lock(mxid32);
+extern	syscall	mutex_unlock(mxid32);
+extern	void	mutexprio(pid32);
+extern	bool8	mutexkill(pid32);
+
 /* in file mount.c */
 extern	syscall	mount(char *, char *, did32);
 extern	int32	namlen(char *, int32);
@@ -300,6 +383,13 @@ extern	syscall	read(did32, char *, uint32);
 
 /* in file ready.c */
 extern	status	ready(pid32);
+extern	void	readyinsert(pid32, int32);
+extern	pid32	readyget(void);
+extern	void	readyremove(pid32);
+extern	bool8	readyfirst(pid32);
+extern	bool8	readybefore(pid32, pid32);
+extern	void	readyplace(pid32);
+extern	void	readysteal(void);
 
 /* in file receive.c */
 extern	umsg32	receive(void);
@@ -347,8 +437,37 @@ extern	syscall	signal(sid32);
 /* in file signaln.c */
 extern	syscall	signaln(sid32, int32);
 
+/* in file slab.c */
+extern	status	cacheinit(void);
+extern	cid32	cache_create(uint32, uint32);
+extern	status	cache_ctor(cid32, void (*)(void *));
+extern	void	*cache_alloc(cid32);
+extern	syscall	cache_free(cid32, void *);
+extern	int32	cache_reclaim(void);
+extern	syscall	cache_delete(cid32);
+
+/* in file smp.c */
+extern	void	smpinit(void);
+extern	void	smpboot(void);
+extern	void	apmain(void);
+extern	int32	getcpu(void);
+extern	void	klockacquire(void);
+extern	void	klockrelease(void);
+extern	void	cpuipi(int32, uint32);
+extern	void	cpurequest(pid32);
+extern	void	ipihandler(void);
+extern	void	tlbshootdown(uint32);
+extern	void	tlbevict(uint32);
+
+/* in file sleepq.c */
+extern	status	sleepinsert(pid32, int32);
+extern	void	sleeptick(void);
+extern	uint32	sleepnext(uint32);
+extern	status	sleepswitch(int32);
+
 /* in file sleep.c */
 extern	syscall	sleepms(int32);
+extern	syscall	sleepus(int32);
 extern	syscall	sleep(int32);
 
 /* in file start.S */
@@ -362,6 +481,7 @@ extern	int32	insw(int32, int32 ,int32);
 extern	int32	outsw(int32, int32, int32);
 extern	int32	lidt(void);
 extern	int32	cpuid(void);
+extern	uint32	cpufeat(void);
 
 /* in file suspend.c */
 extern	syscall	suspend(pid32);
@@ -400,6 +520,13 @@ extern	devcall	ttyread(struct dentry *, char *, int32);
 extern	devcall	ttywrite(struct dentry *, char *, int32);
 
 
+/* in file tsc.c */
+extern	uint64	udiv64(uint64, uint32, uint32 *);
+extern	void	tscinit(void);
+extern	void	tscsync(void);
+extern	uint64	getcycles(void);
+extern	uint64	getnanos(void);
+
 /* in file unsleep.c */
 extern	syscall	unsleep(pid32);
 
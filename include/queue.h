@@ -1,11 +1,18 @@
-/* queue.h - firstid, firstkey, isempty, lastkey, nonempty		*/
+/* queue.h - firstid, firstkey, isempty, lastkey, nonempty, readyq, readykey */
 
 /* Queue structure declarations, constants, and inline functions	*/
 
-/* Default # of queue entries: 1 per process plus 2 for ready list plus	*/
-/*			2 for sleep list plus 2 per semaphore		*/
+/* Each processor has NRQBAND ready queues, by priority, highest	*/
+/*   queue first; its cpreadymap has a bit set for each nonempty one	*/
+#define	NRQBAND	32
+#define	EDFBAND	(NRQBAND - 1)	/* ready EDF processes, by deadline	*/
+
+/* Default # of queue entries: 1 per process plus 2 per ready queue	*/
+/*		of each processor plus 2 for sleep list plus 2 per	*/
+/*		timing wheel slot plus 2 per semaphore plus 2 per mutex	*/
 #ifndef NQENT
-#define NQENT	(NPROC + 4 + NSEM + NSEM)
+#define NQENT	(NPROC + 2 * NRQBAND * NCPU + 2 + 2 * SLPLEVELS * SLPSLOTS	\
+			+ NSEM + NSEM + NMUTEX + NMUTEX)
 #endif
 
 #define	EMPTY	(-1)		/* Null value for qnext or qprev index	*/
@@ -31,6 +38,14 @@ extern	struct qentry	queuetab[];
 #define	firstkey(q)	(queuetab[firstid(q)].qkey)
 #define	lastkey(q)	(queuetab[ lastid(q)].qkey)
 
+/* Ready queue of band b of processor entry c, and the priority of the	*/
+/*   process readyget would return there (MINKEY if none) without	*/
+/*   removing it							*/
+
+#define	readyq(c, b)	((c)->cpreadylist + 2 * (b))
+#define	readykey(c)	((c)->cpreadymap == 0 ? (int32)MINKEY		\
+			: firstkey(readyq((c), HighBit((c)->cpreadymap))))
+
 /* Inline to check queue id assumes interrupts are disabled */
 
 #define	isbadqid(x)	(((int32)(x) < NPROC) || (int32)(x) >= NQENT-1)
@@ -14,3 +14,6 @@ struct	defer	{
 };
 
 extern	struct	defer	Defer;
+
+extern	uint32	cr3loads;	/* Context switches that reloaded CR3	*/
+extern	uint32	cr3skips;	/* Context switches that kept CR3	*/
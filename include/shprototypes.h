@@ -7,6 +7,9 @@ extern	shellcmd  xsh_arp	(int32, char *[]);
 /* in file xsh_bingid.c */
 extern	shellcmd  xsh_bingid	(int32, char *[]);
 
+/* in file xsh_cachestat.c */
+extern	shellcmd  xsh_cachestat	(int32, char *[]);
+
 /* in file xsh_cat.c */
 extern	shellcmd  xsh_cat	(int32, char *[]);
 
@@ -28,6 +31,9 @@ extern	shellcmd  xsh_ethstat	(int32, char *[]);
 /* in file xsh_exit.c */
 extern	shellcmd  xsh_exit	(int32, char *[]);
 
+/* in file xsh_heapbench.c */
+extern	shellcmd  xsh_heapbench	(int32, char *[]);
+
 /* in file xsh_help.c */
 extern	shellcmd  xsh_help	(int32, char *[]);
 
@@ -37,12 +43,21 @@ extern	shellcmd  xsh_kill	(int32, char *[]);
 /* in file xsh_led.c */
 extern	shellcmd  xsh_led	(int32, char *[]);
 
+/* in file xsh_lfsbench.c */
+extern	shellcmd  xsh_lfsbench	(int32, char *[]);
+
+/* in file xsh_lfsstat.c */
+extern	shellcmd  xsh_lfsstat	(int32, char *[]);
+
 /* in file xsh_memdump.c */
 extern	shellcmd  xsh_memdump	(int32, char *[]);
 
 /* in file xsh_memstat.c */
 extern	shellcmd  xsh_memstat	(int32, char *[]);
 
+/* in file xsh_mutexstat.c */
+extern	shellcmd  xsh_mutexstat	(int32, char *[]);
+
 /* in file xsh_netinfo.c */
 extern	shellcmd  xsh_netinfo	(int32, char *[]);
 
@@ -55,9 +70,18 @@ extern	shellcmd  xsh_ping	(int32, char *[]);
 /* in file xsh_ps.c */
 extern	shellcmd  xsh_ps	(int32, char *[]);
 
+/* in file xsh_rtstat.c */
+extern	shellcmd  xsh_rtstat	(int32, char *[]);
+
 /* in file xsh_sleep.c */
 extern	shellcmd  xsh_sleep	(int32, char *[]);
 
+/* in file xsh_sleepbench.c */
+extern	shellcmd  xsh_sleepbench (int32, char *[]);
+
+/* in file xsh_top.c */
+extern	shellcmd  xsh_top	(int32, char *[]);
+
 /* in file xsh_udpdump.c */
 extern	shellcmd  xsh_udpdump	(int32, char *[]);
 
@@ -70,5 +94,8 @@ extern	shellcmd  xsh_udpeserver (int32, char *[]);
 /* in file xsh_uptime.c */
 extern	shellcmd  xsh_uptime	(int32, char *[]);
 
+/* in file xsh_vmstat.c */
+extern	shellcmd  xsh_vmstat	(int32, char *[]);
+
 /* in file xsh_help.c */
 extern	shellcmd  xsh_help	(int32, char *[]);
@@ -0,0 +1,45 @@
+/* slab.h - object caches built from page-sized slabs */
+
+#ifndef	NCACHE
+#define	NCACHE		16	/* Maximum number of object caches	*/
+#endif
+
+#define	CA_FREE		0	/* Cache table entry is unused		*/
+#define	CA_USED		1	/* Cache table entry is in use		*/
+
+#define	SLAB_MAXOBJ	256	/* Max. objects in one slab		*/
+#define	SLAB_MAPW	(SLAB_MAXOBJ / 32)	/* Words of free bitmap	*/
+#define	SLAB_MAGIC	0x51AB51AB	/* Marks the header of a slab	*/
+
+/* A slab is one page from the frame allocator, used through the	*/
+/*   direct map so its objects are valid in every address space.	*/
+/*   The header sits at the start of the page and the objects follow	*/
+
+struct	slab	{
+	uint32	slmagic;	/* SLAB_MAGIC				*/
+	cid32	slcache;	/* Cache this slab belongs to		*/
+	struct	slab	*slnext;/* Next slab on the same cache list	*/
+	struct	slab	*slprev;/* Previous slab on that list		*/
+	uint32	slinuse;	/* Objects currently allocated		*/
+	uint32	slmap[SLAB_MAPW];/* Bit set: object is free		*/
+};
+
+struct	caentry	{		/* Entry in the cache table		*/
+	uint16	castate;	/* CA_FREE or CA_USED			*/
+	uint16	caperslab;	/* Objects in each slab			*/
+	uint32	casize;		/* Object size, rounded to alignment	*/
+	uint32	caoffset;	/* Offset of the first object in a slab	*/
+	void	(*cactor)(void *);/* Constructor run on new objects	*/
+	struct	slab	*capartial;/* Slabs with at least one free obj	*/
+	struct	slab	*cafull;/* Slabs with no free object		*/
+	uint32	canslabs;	/* Slabs owned by the cache		*/
+	uint32	canempty;	/* Slabs with every object free		*/
+	uint32	cainuse;	/* Objects allocated			*/
+	uint32	cahits;		/* Allocations from an existing slab	*/
+	uint32	camisses;	/* Allocations that needed a new slab	*/
+};
+
+extern	struct	caentry	cachetab[];
+
+#define	isbadcache(c)	((int32)(c) < 0 || (c) >= NCACHE || \
+			 cachetab[(c)].castate != CA_USED)
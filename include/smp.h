@@ -0,0 +1,227 @@
+/* smp.h - cpuself, cpucurrpid, spintry, spinacquire, spinrelease,	*/
+/*		spindisable, spinrestore				*/
+
+/* Processors found in the MP or ACPI tables; entry 0 is always the	*/
+/*   bootstrap processor (BSP) that runs Xinu			*/
+
+#define	NCPU		8		/* most processors handled	*/
+
+#define	CPU_ABSENT	0		/* cpstate: no such processor	*/
+#define	CPU_FOUND	1		/*   listed by the firmware	*/
+#define	CPU_ONLINE	2		/*   started and running	*/
+
+/* Work another processor asks for with an IPI (bits of cpipiwork)	*/
+
+#define	IPI_RESCHED	0x1		/* a process it should run is	*/
+					/*   ready				*/
+#define	IPI_REQUEST	0x2		/* kill or suspend a process it	*/
+					/*   runs (see prreq)		*/
+
+/* Each processor reaches its own entry through the per-CPU segment	*/
+/*   in %fs, so the scheduling state below is per processor		*/
+
+struct	cpuent	{
+	int32	cpindex;		/* Index of the entry in cputab	*/
+	pid32	cpcurrpid;		/* Process it is running	*/
+	uint32	cpstate;		/* CPU_ABSENT, FOUND or ONLINE	*/
+	uint32	cpapicid;		/* ID of its local APIC		*/
+	uint32	cpcr3;			/* Page directory it runs in	*/
+	uint32	cpipis;			/* IPIs it has taken		*/
+	volatile uint32	cpipiwork;	/* IPI_ work not yet done	*/
+	pid32	cpidlepid;		/* Its idle process		*/
+	qid16	cpreadylist;		/* Its first ready queue	*/
+	uint32	cpreadymap;		/* Bit b set: ready queue b has	*/
+					/*   a process			*/
+	uint32	cppreempt;		/* Ticks left in the time slice	*/
+	pid32	cpfpuowner;		/* Process whose state its FPU	*/
+					/*   holds, or -1		*/
+	uint64	cpcharged;		/* Stamp of the last CPU charge	*/
+	uint64	cpnexttick;		/* TSC deadline of its next tick*/
+	uint32	cpreap;			/* Page directory of a process	*/
+					/*   that killed itself here	*/
+	struct	tss	cptssmain;	/* State of the running process	*/
+	struct	tss	cptsspf;	/* Its page fault task		*/
+};
+
+extern	struct	cpuent	cputab[];
+extern	int32	ncpus;		/* processors found			*/
+extern	int32	ncpuonline;	/* processors running			*/
+extern	uint32	lapicphys;	/* physical address of the local APICs	*/
+extern	uint32	ioapicphys;	/* physical address of the I/O APIC	*/
+extern	volatile uint32	*lapic;	/* mapped local APIC, NULL if none	*/
+extern	volatile uint32	*ioapic;/* mapped I/O APIC, NULL if none	*/
+
+/* The APIC registers (physical 0xFEC00000 up) are mapped uncached in	*/
+/*   page directory entry MMIO_PDE of every address space		*/
+
+#define	MMIO_PDE	1022
+#define	MMIO_BASE	0xFF800000	/* virtual address of MMIO_PHYS	*/
+#define	MMIO_PHYS	0xFEC00000
+#define	MMIO_SIZE	0x00400000
+
+/* Local APIC registers, as indexes of 32-bit words */
+
+#define	LAPIC_ID	(0x020 / 4)	/* APIC ID in bits 24-31	*/
+#define	LAPIC_EOI	(0x0b0 / 4)	/* end of interrupt		*/
+#define	LAPIC_SVR	(0x0f0 / 4)	/* spurious vector, enable bit	*/
+#define	LAPIC_ESR	(0x280 / 4)	/* error status			*/
+#define	LAPIC_ICRLO	(0x300 / 4)	/* interrupt command, low half	*/
+#define	LAPIC_ICRHI	(0x310 / 4)	/*   and destination in 24-31	*/
+#define	LAPIC_IRR	(0x200 / 4)	/* requests, 8 words 16 B apart	*/
+#define	LAPIC_LVTT	(0x320 / 4)	/* timer vector and mode	*/
+#define	LAPIC_LINT0	(0x350 / 4)	/* LINT0 pin (the 8259 output)	*/
+#define	LAPIC_TICR	(0x380 / 4)	/* timer initial count		*/
+#define	LAPIC_TCCR	(0x390 / 4)	/* timer current count		*/
+#define	LAPIC_TDCR	(0x3e0 / 4)	/* timer divide configuration	*/
+
+#define	SVR_ENABLE	0x00000100	/* APIC software enable		*/
+
+#define	ICR_FIXED	0x00000000	/* delivery modes		*/
+#define	ICR_INIT	0x00000500
+#define	ICR_STARTUP	0x00000600
+#define	ICR_PENDING	0x00001000	/* delivery status: not sent	*/
+#define	ICR_ASSERT	0x00004000	/* level: assert		*/
+#define	ICR_LEVEL	0x00008000	/* trigger mode: level		*/
+
+#define	LVT_MASKED	0x00010000	/* local vector table entries	*/
+#define	LVT_PERIODIC	0x00020000	/* timer: reload the count	*/
+#define	LVT_DEADLINE	0x00040000	/* timer: fire at a TSC value	*/
+#define	TDCR_DIV16	0x00000003	/* timer counts bus clock / 16	*/
+
+/* I/O APIC registers, reached through a select and a window register	*/
+
+#define	IOAPIC_SEL	0		/* word index of the select	*/
+#define	IOAPIC_WIN	(0x10 / 4)	/*   and of the window		*/
+#define	IOAPIC_VER	0x01		/* version, entries in 16-23	*/
+#define	IOAPIC_REDTBL	0x10		/* redirection entries, 2 each	*/
+#define	RED_MASKED	0x00010000	/* entry does not deliver	*/
+
+#define	NISAIRQ		16		/* IRQs of the 8259 pair	*/
+extern	uint32	irqgsi[];	/* I/O APIC input of each ISA IRQ	*/
+
+#define	IRQ_LTIMER	0x30		/* vector of the APIC timer	*/
+#define	IRQ_IPI		0xf0		/* vector of interprocessor IRQs*/
+#define	IRQ_SPURIOUS	0xff		/* vector of spurious APIC IRQs	*/
+
+/* When the APICs are used, the local APIC timer replaces the 8254	*/
+
+#define	LT_NONE		0		/* lapictimer: 8254 clock chip	*/
+#define	LT_PERIODIC	1		/*   periodic count		*/
+#define	LT_DEADLINE	2		/*   TSC deadline		*/
+#define	LAPICMAXIDLE	10000		/* most ticks of a one-shot	*/
+
+extern	uint32	lapictimer;	/* source of the clock tick		*/
+extern	volatile uint32	*lapiceoi;	/* EOI register of the local	*/
+					/*   APIC, NULL under the 8259	*/
+
+#define	APBOOT		0x8000		/* where APs start, real mode	*/
+#define	APSTK		8192		/* stack of an AP's idle process*/
+
+/* A processor is idle when it runs its idle process and has no other	*/
+/*   process ready; idle processes are only ever on ready queue 0	*/
+
+#define	isidlepid(pid)	(cputab[proctab[pid].prcpu].cpidlepid == (pid))
+#define	cpuidle(cpptr)	((cpptr)->cpcurrpid == (cpptr)->cpidlepid	\
+			&& ((cpptr)->cpreadymap & ~1) == 0)
+
+#ifdef SMP
+/*------------------------------------------------------------------------
+ *  cpuself  -  Return the entry of the running processor
+ *------------------------------------------------------------------------
+ */
+static inline struct cpuent *cpuself(void)
+{
+	int32	cpu;
+
+	asm volatile("movl %%fs:%c1, %0" : "=r"(cpu)
+		: "i"(__builtin_offsetof(struct cpuent, cpindex)));
+	return &cputab[cpu];
+}
+
+/*------------------------------------------------------------------------
+ *  cpucurrpid  -  Return the process running on this processor (what
+ *		   currpid stands for); one load, so a process that moves
+ *		   to another processor cannot read a stale entry
+ *------------------------------------------------------------------------
+ */
+static inline pid32 cpucurrpid(void)
+{
+	pid32	pid;
+
+	asm volatile("movl %%fs:%c1, %0" : "=r"(pid)
+		: "i"(__builtin_offsetof(struct cpuent, cpcurrpid))
+		: "memory");
+	return pid;
+}
+#else
+/* Without SMP (see compile/Makefile) only the BSP runs processes	*/
+
+#define	cpuself()	(&cputab[0])
+#define	cpucurrpid()	(cputab[0].cpcurrpid)
+#endif
+
+/* Spin locks order the processors that share a structure; take them	*/
+/*   with interrupts disabled so that a handler on the same processor	*/
+/*   cannot spin on a lock its own process holds. disable() takes the	*/
+/*   kernel lock, klock, whenever it turns interrupts off, so on each	*/
+/*   processor interrupts are off exactly while it holds klock, except	*/
+/*   inside spindisable; code holding only a spindisable lock must not	*/
+/*   call disable							*/
+
+struct	spinlock {
+	volatile uint32	sllocked;	/* nonzero while held		*/
+};
+
+static inline bool8 spintry(struct spinlock *lock)
+{
+	uint32	held;
+
+	held = 1;
+	asm volatile("xchgl %0, %1" : "+r"(held), "+m"(lock->sllocked)
+			: : "memory");
+	return held == 0;
+}
+
+static inline void spinacquire(struct spinlock *lock)
+{
+	while (!spintry(lock)) {
+		while (lock->sllocked) {
+			asm volatile("pause");
+		}
+	}
+}
+
+static inline void spinrelease(struct spinlock *lock)
+{
+	asm volatile("" : : : "memory");	/* stores stay in order	*/
+	lock->sllocked = 0;
+}
+
+/*------------------------------------------------------------------------
+ *  spindisable  -  Disable interrupts without taking the kernel lock,
+ *		    take a lock and return the previous interrupt mask
+ *------------------------------------------------------------------------
+ */
+static inline intmask spindisable(struct spinlock *lock)
+{
+	intmask	mask;
+
+	asm volatile("pushfl; cli; popl %0" : "=r"(mask) : : "memory");
+	spinacquire(lock);
+	return mask & 0x00000200;
+}
+
+/*------------------------------------------------------------------------
+ *  spinrestore  -  Release a lock taken by spindisable and restore the
+ *		    interrupt mask
+ *------------------------------------------------------------------------
+ */
+static inline void spinrestore(struct spinlock *lock, intmask mask)
+{
+	spinrelease(lock);
+	if (mask != 0) {
+		asm volatile("sti" : : : "memory");
+	}
+}
+
+extern	struct	spinlock klock;	/* The kernel lock (see disable)	*/
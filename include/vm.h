@@ -11,13 +11,112 @@ struct page
 #define PTE_P 0x001 // Present
 #define PTE_W 0x002 // Writeable
 #define PTE_U 0x004 // User
+#define PTE_PWT 0x008 // Write-through
+#define PTE_PCD 0x010 // Cache disabled (device registers)
+#define PTE_PS 0x080 // 4 MB page (page directory entries only)
+#define PTE_G 0x100  // Global, survives CR3 reloads (needs CR4.PGE)
+#define PTE_COW 0x200 // Available to software: read-only until written, then copied
 
-#define Write0x1fff000(index, entry) ((struct page *)0x1fff000)->entries[index] = entry
-#define GetEntryFrom0x1fff000(index) ((struct page *)0x1fff000)->entries[index]
-void MkpgAccessibleby0x1fff000(uint32 paddr);
+/* Map the kernel region and the direct map with 4 MB pages when the CPU has PSE;
+ * undefine to always build them from 4 KB page tables */
+#define VM_PSE
+
+/* Mark the kernel region and the direct map global when the CPU has PGE,
+ * so their TLB entries survive context switches; undefine to disable */
+#define VM_PGE
+
+extern uint32 vm_pse; /* Nonzero when 4 MB kernel pages are in use */
+extern uint32 vm_pge; /* Nonzero when kernel pages are global */
+
+#define KERNEL_PGDIR (KERNEL_END - 10 * PAGE_SIZE) /* Null process's page directory */
+#define KSTK_PDE 1021                               /* Null process's stack page table */
+
+/* Direct map: usable physical memory is mapped at DM_BASE in every page directory */
+
+#define DM_BASE 0xC0000000     /* Virtual address of physical address 0 */
+#define DM_MAX 0x3F000000      /* Max. physical memory mapped (1008 MB) */
+#define DM_PDE (DM_BASE >> 22) /* First page directory entry of the direct map */
+
+#define phys_to_virt(paddr) ((void *)((uint32)(paddr) + DM_BASE))
+#define virt_to_phys(vaddr) ((uint32)(vaddr) - DM_BASE) /* Direct map addresses only */
+
+extern struct page *dmtabs; /* Page tables of the direct map */
+extern uint32 ndmpdes;      /* Page directory entries used by the direct map */
+
+/* Page directory entries shared by every address space */
+#define IsKernelPde(i) ((i) < 8 || (i) == KSTK_PDE || (i) == MMIO_PDE || ((i) >= DM_PDE && (i) < DM_PDE + ndmpdes))
+
+uint32 ReadCr3(void);
+
+uint32 VirtToPhys(uint32 pgdir, uint32 vaddr);
+status CopyToVirt(uint32 pgdir, uint32 vaddr, void *src, uint32 nbytes);
+
+/* Demand paging: heap [KERNEL_END, maxheap) and stack [StackBottom, 4 GB) are
+ * only reserved; a zeroed frame is mapped on the first touch of each page */
+
+#define PF_P 0x1 // Error code: protection violation (page was present)
+#define PF_W 0x2 // Error code: write access
+
+#define StackBottom(prptr) (0 - Bytes2Pages((prptr)->prstklen) * PAGE_SIZE)
+
+extern uint32 pgfaults;  /* Pages backed on demand since boot */
+extern uint32 cowcopies; /* Pages copied on a write after fork since boot */
+extern uint32 heaptrims; /* Heap pages inside free blocks given back */
+
+uint32 Bytes2Pages(uint32 nbytes);
+uint32 MapZeroPage(uint32 pgdir, uint32 vaddr);
+uint32 CopyOnWrite(uint32 pgdir, uint32 vaddr);
+status ForkSpace(pid32 pid);
+void PageFault(uint32 errcode);
 
 extern uint32 is_page;
 
+/* Physical frame allocator (binary buddy system) */
+
+#define NFRREGION 8    /* Max. number of usable memory regions tracked */
+#define FR_MAXORDER 10 /* Largest block is 2^10 frames (4 MB) */
+
+struct frregion
+{
+    uint32 fr_base;   /* Physical address of the first frame */
+    uint32 fr_npages; /* Number of frames in the region */
+    uint32 fr_index;  /* Index of the first frame in frtab */
+};
+
+/* Frame states */
+#define FR_USED 0  /* Allocated */
+#define FR_FREE 1  /* Heads a free block on frfree[fe_order] */
+#define FR_INNER 2 /* Free, but inside a larger free block */
+
+struct frentry
+{
+    int32 fe_next;   /* Next free block of the same order */
+    int32 fe_prev;   /* Previous free block of the same order */
+    uint16 fe_order; /* Order of the free block this frame heads */
+    uint16 fe_state; /* FR_USED, FR_FREE or FR_INNER */
+    uint32 fe_refs;  /* Page tables mapping a used frame (copy-on-write sharing) */
+};
+
+extern struct frregion frregions[];
+extern uint32 nfrregions;
+extern struct frentry *frtab;        /* One entry per managed frame */
+extern int32 frfree[];               /* Per-order free list heads */
+extern uint32 frnfree[];             /* Free blocks of each order */
+extern uint32 free_pages;            /* Frames on the free lists */
+extern uint32 total_pages;           /* Frames managed by the allocator */
+
+#define FrameInUse(index) (frtab[(index)].fe_state == FR_USED)
+
+int32 FrameIndex(uint32 paddr);
+uint32 Pages2Order(uint32 npages);
+struct page *GetPages(uint32 order);
+struct page *GetPagesN(uint32 npages);
+void FreePages(struct page *addr, uint32 order);
+struct page *GetOnePage(void);
+void FreeOnePage(struct page *addr);
+void ShareFrame(uint32 paddr);
+void PutFrame(uint32 paddr);
+
 uint32 heapsbrk(uint32 nbytes);
 
 /* single word (4) or double word (8) alignment */
@@ -28,6 +127,14 @@ uint32 heapsbrk(uint32 nbytes);
 
 #define SIZE_T_SIZE (ALIGN(sizeof(uint32)))
 
+/* Segregated free lists: every free block is on the list of its size class,
+ * one class per size up to HEAP_SMALLMAX (so any block there fits exactly),
+ * then one per power of two; the last of the HEAP_NCLASS classes is open ended */
+#define HEAP_MINBLK 16                                          /* Tags plus the two list links */
+#define HEAP_SMALLMAX 64                                        /* Largest exactly sized class */
+#define HEAP_NSMALL ((HEAP_SMALLMAX - HEAP_MINBLK) / ALIGNMENT + 1) /* Number of exact classes */
+#define HEAP_HOLE 0x2                                           /* In a free header: some pages inside are unbacked */
+
 char *allocmem(
     uint32 nbytes /* Size of memory requested	*/
 );
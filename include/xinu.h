@@ -7,6 +7,7 @@
 #include <resched.h>
 #include <mark.h>
 #include <semaphore.h>
+#include <mutex.h>
 #include <memory.h>
 #include <bufpool.h>
 #include <clock.h>
@@ -25,5 +26,8 @@
 #include <multiboot.h>
 #include <stdio.h>
 #include <string.h>
+#include <cpu.h>
 #include <vm.h>
+#include <slab.h>
+#include <smp.h>
 
@@ -3,8 +3,6 @@
 #include <xinu.h>
 #include "shprototypes.h"
 
-extern void FlushTlb(void *page);
-
 /*------------------------------------------------------------------------
  *  addargs  -  Add local copy of argv-style arguments to the stack of
  *		  a command process that has been created by the shell
@@ -33,6 +31,8 @@ status	addargs(
 	uint32	*search;		/* pointer that searches for	*/
 					/*   dummy argument on stack	*/
 	uint32	*aptr;			/* Walks through args array	*/
+	uint32	argval;			/* Value stored into args array	*/
+	uint32	*word;			/* Direct map address of search	*/
 	int32	i;			/* Index into tok array		*/
 
 	mask = disable();
@@ -49,13 +49,10 @@ status	addargs(
 	/* Compute lowest location in the process stack where the	*/
 	/*	args array will be stored followed by the argument	*/
 	/*	strings							*/
-	uint32 stk_pg = proctab[pid].phypgdir;
-	MkpgAccessibleby0x1fff000(stk_pg); // now we hope that pgdir's physical page can be accessed by 0x1fff000
-	stk_pg = GetEntryFrom0x1fff000(1023); 
-	MkpgAccessibleby0x1fff000(stk_pg);
-	stk_pg = GetEntryFrom0x1fff000(1023);
-	MkpgAccessibleby0x1fff000(stk_pg);
-	aloc = (uint32)(0x1fff000 - prptr->prstklen + sizeof(uint32));
+	/*	(addresses are in the new process's address space and	*/
+	/*	are written through the direct map)			*/
+
+	aloc = (uint32) (prptr->prstkbase - prptr->prstklen + sizeof(uint32));
 	argloc = (uint32*) ((aloc + 3) & ~0x3);	/* round multiple of 4	*/
 
 	/* Compute the first location beyond args array for the strings	*/
@@ -65,28 +62,33 @@ status	addargs(
 	/* Set each location in the args vector to be the address of	*/
 	/*	string area plus the offset of this argument		*/
 
-	for (aptr=argloc, i=0; i < ntok; i++) {
-		*aptr++ = (uint32) (argstr + tok[i]);
+	for (aptr=argloc, i=0; i < ntok; i++, aptr++) {
+		argval = (uint32) (argstr + tok[i]);
+		CopyToVirt(prptr->phypgdir, (uint32)aptr, &argval,
+							sizeof(uint32));
 	}
 
 	/* Add a null pointer to the args array */
 
-	*aptr++ = (uint32)NULL;
+	argval = (uint32)NULL;
+	CopyToVirt(prptr->phypgdir, (uint32)aptr++, &argval, sizeof(uint32));
 
 	/* Copy the argument strings from tokbuf into process's	stack	*/
 	/*	just beyond the args vector				*/
 
-	memcpy(aptr, tokbuf, tlen);
+	CopyToVirt(prptr->phypgdir, (uint32)aptr, tokbuf, tlen);
 
 	/* Find the second argument in process's stack */
 
-	for (search = (uint32 *)((uint32)prptr->prstkptr & 0x1ffffff);
-	     search < (uint32 *)((uint32)prptr->prstkbase & 0x1fffffff); search++) {
+	for (search = (uint32 *)prptr->prstkptr;
+	     search < (uint32 *)prptr->prstkbase; search++) {
 
 		/* If found, replace with the address of the args vector*/
 
-		if (*search == (uint32)dummy) {
-			*search = (uint32)argloc;
+		word = (uint32 *)phys_to_virt(VirtToPhys(prptr->phypgdir,
+							(uint32)search));
+		if (*word == (uint32)dummy) {
+			*word = (uint32)argloc;
 			restore(mask);
 			return OK;
 		}
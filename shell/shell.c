@@ -9,19 +9,28 @@
 /************************************************************************/
 const	struct	cmdent	cmdtab[] = {
 	{"argecho",	TRUE,	xsh_argecho},
+	{"cachestat",	FALSE,	xsh_cachestat},
 	{"cat",		FALSE,	xsh_cat},
 	{"clear",	TRUE,	xsh_clear},
 	{"date",	FALSE,	xsh_date},
 	{"devdump",	FALSE,	xsh_devdump},
 	{"echo",	FALSE,	xsh_echo},
 	{"exit",	TRUE,	xsh_exit},
+	{"heapbench",	FALSE,	xsh_heapbench},
 	{"help",	FALSE,	xsh_help},
 	{"kill",	TRUE,	xsh_kill},
+	{"lfsbench",	FALSE,	xsh_lfsbench},
+	{"lfsstat",	FALSE,	xsh_lfsstat},
 	{"memdump",	FALSE,	xsh_memdump},
 	{"memstat",	FALSE,	xsh_memstat},
+	{"mutexstat",	FALSE,	xsh_mutexstat},
 	{"ps",		FALSE,	xsh_ps},
+	{"rtstat",	FALSE,	xsh_rtstat},
 	{"sleep",	FALSE,	xsh_sleep},
+	{"sleepbench",	FALSE,	xsh_sleepbench},
+	{"top",		FALSE,	xsh_top},
 	{"uptime",	FALSE,	xsh_uptime},
+	{"vmstat",	FALSE,	xsh_vmstat},
 	{"?",		FALSE,	xsh_help}
 
 };
@@ -0,0 +1,59 @@
+/* xsh_cachestat.c - xsh_cachestat */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+/*------------------------------------------------------------------------
+ * xsh_cachestat - Print the size, occupancy and hit counts of each
+ *			object cache
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_cachestat(int nargs, char *args[])
+{
+	struct	caentry	entry;		/* Snapshot of a cache entry	*/
+	intmask	mask;			/* Saved interrupt mask		*/
+	uint32	capacity;		/* Objects the slabs can hold	*/
+	int32	i;
+
+	/* For argument '--help', emit help about the 'cachestat' command*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("use: %s \n\n", args[0]);
+		printf("Description:\n");
+		printf("\tDisplays, for each object cache, the object size,\n");
+		printf("\tthe slabs in use, the objects allocated out of the\n");
+		printf("\tslab capacity, and the allocations that found a\n");
+		printf("\tfree object (hits) or needed a new slab (misses).\n");
+		printf("Options:\n");
+		printf("\t--help\t\tdisplay this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 1) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	printf("%5s %6s %6s %6s %15s %4s %10s %10s\n", "cache", "size",
+		"slabs", "empty", "objects", "occ", "hits", "misses");
+	for (i = 0; i < NCACHE; i++) {
+		mask = disable();
+		entry = cachetab[i];
+		restore(mask);
+		if (entry.castate != CA_USED) {
+			continue;
+		}
+		capacity = entry.canslabs * entry.caperslab;
+		printf("%5d %6d %6d %6d %7d/%-7d %3d%% %10u %10u\n", i,
+			entry.casize, entry.canslabs, entry.canempty,
+			entry.cainuse, capacity,
+			capacity ? entry.cainuse * 100 / capacity : 0,
+			entry.cahits, entry.camisses);
+	}
+	return 0;
+}
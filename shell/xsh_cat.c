@@ -4,6 +4,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#define	CATBUF	512			/* bytes to read from a file at	*/
+					/*   a time			*/
+
 /*------------------------------------------------------------------------
  * xsh_cat - shell command to cat one or more files
  *------------------------------------------------------------------------
@@ -14,6 +17,8 @@ shellcmd xsh_cat(int nargs, char *args[])
 	int32	nextch;			/* character read from file	*/
 	did32	descr;			/* descriptor for a file	*/
 	char	*argptr;		/* pointer to next arg string	*/
+	int32	nread;			/* bytes read from a file	*/
+	char	buf[CATBUF];		/* data read from a file	*/
 
 
 	/* For argument '--help', emit help about the 'cat' command	*/
@@ -48,10 +53,16 @@ shellcmd xsh_cat(int nargs, char *args[])
 				return 1;
 			}
 		}
-		nextch = getc(descr);
-		while (nextch != EOF) {
-			putc(stdout, nextch);
+		if (descr == stdin) {
 			nextch = getc(descr);
+			while (nextch != EOF) {
+				putc(stdout, nextch);
+				nextch = getc(descr);
+			}
+			continue;
+		}
+		while ((nread = read(descr, buf, CATBUF)) > 0) {
+			write(stdout, buf, nread);
 		}
 		close(descr);
 	}
@@ -0,0 +1,86 @@
+/* xsh_heapbench.c - xsh_heapbench */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+/*------------------------------------------------------------------------
+ * xsh_heapbench - Time the allocmem/deallocmem loop run by main
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_heapbench(int nargs, char *args[])
+{
+	int32	rounds;			/* Iterations of the loop	*/
+	int32	i;			/* Counts iterations		*/
+	char	*chptr;			/* Walks through argument	*/
+	char	ch;			/* Next character of argument	*/
+	char	*a, *c, *d;		/* Blocks allocated by the loop	*/
+	uint64	start;			/* Cycle counter at the start	*/
+	uint32	cycles;			/* Cycles taken by all rounds	*/
+
+	/* For argument '--help', emit help about the 'heapbench' command*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s [rounds]\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tRuns the allocmem/deallocmem loop of main (three\n");
+		printf("\tblocks of 4090, 8190 and 40000 bytes) the given\n");
+		printf("\tnumber of times (default 1000) and prints the CPU\n");
+		printf("\tcycles per round\n");
+		printf("Options:\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 2) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	rounds = 1000;
+	if (nargs == 2) {
+		chptr = args[1];
+		ch = *chptr++;
+		rounds = 0;
+		while (ch != NULLCH) {
+			if ( (ch < '0') || (ch > '9') ) {
+				fprintf(stderr, "%s: nondigit in argument\n",
+					args[0]);
+				return 1;
+			}
+			rounds = 10*rounds + (ch - '0');
+			ch = *chptr++;
+		}
+		if (rounds <= 0) {
+			fprintf(stderr, "%s: rounds must be positive\n",
+				args[0]);
+			return 1;
+		}
+	}
+
+	/* Only the low 32 bits of the cycle count are kept, which is	*/
+	/*   enough for runs of up to a second or so			*/
+
+	start = getticks();
+	for (i = 0; i < rounds; i++) {
+		a = allocmem(4090);
+		c = allocmem(8190);
+		d = allocmem(40000);
+		if (a == NULL || c == NULL || d == NULL) {
+			fprintf(stderr, "%s: out of heap memory\n", args[0]);
+			return 1;
+		}
+		deallocmem(c, PLACEHOLDER);
+		deallocmem(a, PLACEHOLDER);
+		deallocmem(d, PLACEHOLDER);
+	}
+	cycles = (uint32)(getticks() - start);
+
+	printf("%d rounds, %u cycles, %u cycles per round\n",
+		rounds, cycles, cycles / rounds);
+	return 0;
+}
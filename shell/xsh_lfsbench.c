@@ -0,0 +1,176 @@
+/* xsh_lfsbench.c - xsh_lfsbench, lfsrate */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+#define	BENCHFILE	"lfsbench"	/* Scratch file of the benchmark*/
+#define	BENCHBUF	2048		/* Bytes per read or write call	*/
+#define	RANDREADS	1000		/* Reads at random positions	*/
+
+extern	int	rand_r(unsigned int *);
+
+/*------------------------------------------------------------------------
+ * lfsrate - Print the throughput of a run in MB/s, to two decimals
+ *------------------------------------------------------------------------
+ */
+local	void	lfsrate(
+	  char		*what,		/* Name of the run		*/
+	  uint32	bytes,		/* Bytes moved			*/
+	  uint64	ns		/* Time taken in nanoseconds	*/
+	)
+{
+	uint32	us;			/* Time taken in microseconds	*/
+	uint32	rate;			/* Hundredths of a MB/s		*/
+
+	us = (uint32)udiv64(ns, 1000, NULL);
+	if (us == 0) {
+		us = 1;
+	}
+	rate = (uint32)udiv64(((uint64)bytes * 100000000) >> 20, us, NULL);
+	printf("%-18s %10u us %6u.%02u MB/s\n", what, us,
+		rate / 100, rate % 100);
+}
+
+/*------------------------------------------------------------------------
+ * xsh_lfsbench - Write and read back a local file a byte at a time with
+ *		  putc and getc, then in blocks with write and read, and
+ *		  print the throughput of each
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_lfsbench(int nargs, char *args[])
+{
+	int32	kbytes;			/* Size of the file in KB	*/
+	uint32	size;			/* Size of the file in bytes	*/
+	did32	fd;			/* Descriptor of the file	*/
+	uint32	i, n;
+	int32	got;			/* Bytes returned by read	*/
+	char	*chptr;			/* Walks through argument	*/
+	char	ch;			/* Next character of argument	*/
+	uint64	start;			/* Time a run started		*/
+	uint32	ibgets;			/* Index blocks fetched before	*/
+					/*   the random reads		*/
+	unsigned int seed;		/* Seed of the random positions	*/
+	char	buf[BENCHBUF];		/* Data written and read	*/
+
+	/* For argument '--help', emit help about the 'lfsbench' command*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s [kbytes]\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tWrites a local file of kbytes KB (default 2048)\n");
+		printf("\tand reads it back, one byte per call with putc\n");
+		printf("\tand getc and then %d bytes per call with write\n",
+			BENCHBUF);
+		printf("\tand read, then reads %d blocks of %d bytes at\n",
+			RANDREADS, LF_BLKSIZ);
+		printf("\trandom positions, and prints the throughput of\n");
+		printf("\teach run and the index blocks fetched per seek\n");
+		printf("Options:\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 2) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	kbytes = 2048;
+	if (nargs == 2) {
+		chptr = args[1];
+		ch = *chptr++;
+		kbytes = 0;
+		while (ch != NULLCH) {
+			if ( (ch < '0') || (ch > '9') ) {
+				fprintf(stderr, "%s: nondigit in argument\n",
+					args[0]);
+				return 1;
+			}
+			kbytes = 10*kbytes + (ch - '0');
+			ch = *chptr++;
+		}
+		if (kbytes <= 0 || kbytes > 16384) {
+			fprintf(stderr, "%s: kbytes must be 1 to 16384\n",
+				args[0]);
+			return 1;
+		}
+	}
+	size = (uint32)kbytes * 1024;
+	for (i = 0; i < BENCHBUF; i++) {
+		buf[i] = 'a' + i % 26;
+	}
+
+	fd = open(LFILESYS, BENCHFILE, "rw");
+	if (fd == (did32)SYSERR) {
+		fprintf(stderr, "%s: cannot open file %s\n", args[0],
+			BENCHFILE);
+		return 1;
+	}
+
+	/* One byte per call, as lflread and lflwrite used to do	*/
+
+	control(fd, LF_CTL_TRUNC, 0, 0);
+	start = getnanos();
+	for (i = 0; i < size; i++) {
+		if (putc(fd, buf[i % BENCHBUF]) == SYSERR) {
+			break;
+		}
+	}
+	lfsrate("putc", i, getnanos() - start);
+	seek(fd, 0);
+	start = getnanos();
+	for (i = 0; i < size; i++) {
+		if (getc(fd) < 0) {
+			break;
+		}
+	}
+	lfsrate("getc", i, getnanos() - start);
+
+	/* A block of bytes per call */
+
+	control(fd, LF_CTL_TRUNC, 0, 0);
+	start = getnanos();
+	for (i = 0; i < size; i += n) {
+		n = size - i < BENCHBUF ? size - i : BENCHBUF;
+		if (write(fd, buf, n) == SYSERR) {
+			break;
+		}
+	}
+	lfsrate("write", i, getnanos() - start);
+	seek(fd, 0);
+	start = getnanos();
+	for (i = 0; i < size; i += got) {
+		got = read(fd, buf, BENCHBUF);
+		if (got <= 0) {
+			break;
+		}
+	}
+	lfsrate("read", i, getnanos() - start);
+
+	/* A block at a random position per call, each after a seek	*/
+
+	seed = 1;
+	ibgets = Lf_data.lf_ibgets;
+	start = getnanos();
+	for (i = 0; i < RANDREADS; i++) {
+		seek(fd, (rand_r(&seed) % (size / LF_BLKSIZ)) * LF_BLKSIZ);
+		if (read(fd, buf, LF_BLKSIZ) <= 0) {
+			break;
+		}
+	}
+	lfsrate("random read", i * LF_BLKSIZ, getnanos() - start);
+	ibgets = Lf_data.lf_ibgets - ibgets;
+	if (i > 0) {
+		printf("%-18s %6u.%02u i-blocks per seek\n", "", ibgets / i,
+			(ibgets % i) * 100 / i);
+	}
+
+	control(fd, LF_CTL_TRUNC, 0, 0);
+	close(fd);
+	return 0;
+}
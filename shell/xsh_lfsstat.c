@@ -0,0 +1,68 @@
+/* xsh_lfsstat.c - xsh_lfsstat */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+/*------------------------------------------------------------------------
+ * xsh_lfsstat - Print the counters of the local file system block cache
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_lfsstat(int nargs, char *args[])
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	uint32	hits, misses, writebacks;	/* Snapshot of counters	*/
+	uint32	used, dirty;		/* Buffers holding a block, and	*/
+					/*   changed ones among them	*/
+	uint32	lookups;		/* Blocks looked up		*/
+	int32	i;
+
+	/* For argument '--help', emit help about the 'lfsstat' command	*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tDisplays the block cache of the local file system:\n");
+		printf("\tbuffers in use and changed, blocks found in the\n");
+		printf("\tcache and read from disk, and changed blocks\n");
+		printf("\twritten back\n");
+		printf("Options:\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 1) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	mask = disable();
+	hits = Lf_cache.lc_hits;
+	misses = Lf_cache.lc_misses;
+	writebacks = Lf_cache.lc_writebacks;
+	used = dirty = 0;
+	for (i = 0; i < LFC_NBUF; i++) {
+		if (Lf_cache.lc_buf[i].cb_blk != LF_DNULL) {
+			used++;
+		}
+		if (Lf_cache.lc_buf[i].cb_dirty) {
+			dirty++;
+		}
+	}
+	restore(mask);
+
+	lookups = hits + misses;
+	printf("Block cache: %u of %d buffers in use, %u changed\n",
+		used, LFC_NBUF, dirty);
+	printf("  %u hits, %u misses", hits, misses);
+	if (lookups > 0) {
+		printf(" (%u%% hits)", (uint32)udiv64((uint64)hits * 100,
+						lookups, NULL));
+	}
+	printf(", %u write-backs\n", writebacks);
+	return 0;
+}
@@ -19,8 +19,8 @@ shellcmd xsh_memstat(int nargs, char *args[])
 	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
 		printf("use: %s \n\n", args[0]);
 		printf("Description:\n");
-		printf("\tDisplays the current memory use and prints the\n");
-		printf("\tfree list.\n");
+		printf("\tDisplays the current memory use, the physical frame\n");
+		printf("\tcounts and prints the free list.\n");
 		printf("Options:\n");
 		printf("\t--help\t\tdisplay this help and exit\n");
 		return 0;
@@ -110,4 +110,23 @@ static void printMemUse(void)
 	printf("%10d bytes (0x%08x) of Xinu code\n", code, code);
 	printf("%10d bytes (0x%08x) of allocated stack space\n", stack, stack);
 	printf("%10d bytes (0x%08x) of available kernel heap space\n\n", kheap, kheap);
+
+	/* Output statistics on physical frame use */
+
+	printf("Physical frames (%d bytes each):\n", PAGE_SIZE);
+	printf("---------------------------------\n");
+	printf("%10d frames free\n", free_pages);
+	printf("%10d frames in use\n", total_pages - free_pages);
+	printf("%10d frames total in %d region(s)\n", total_pages, nfrregions);
+	for (i = 0; i < nfrregions; i++) {
+		printf("  0x%08x - 0x%08x  %9d frames\n",
+			frregions[i].fr_base,
+			frregions[i].fr_base + frregions[i].fr_npages * PAGE_SIZE,
+			frregions[i].fr_npages);
+	}
+	printf("Free blocks by order:");
+	for (i = 0; i <= FR_MAXORDER; i++) {
+		printf(" %d:%d", i, frnfree[i]);
+	}
+	printf("\n\n");
 }
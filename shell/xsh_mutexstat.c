@@ -0,0 +1,70 @@
+/* xsh_mutexstat.c - xsh_mutexstat */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+/*------------------------------------------------------------------------
+ * xsh_mutexstat - Print the owner, lock counts, and longest wait of each
+ *		   mutex in use
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_mutexstat(int nargs, char *args[])
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	mutent	mx;		/* Copy taken with interrupts	*/
+					/*   disabled			*/
+	uint32	maxus;			/* Longest wait in microseconds	*/
+	int32	i;
+
+	/* For argument '--help', emit help about the 'mutexstat' command*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tLists the mutexes in use with their owner, the\n");
+		printf("\ttimes they were locked, the times a locker had to\n");
+		printf("\twait, and the longest wait in microseconds\n");
+		printf("Options:\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 1) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	printf("%3s %-12s %5s %10s %8s %10s\n",
+		"Mid", "Name", "Owner", "Locks", "Waits", "Max wait");
+	for (i = 0; i < NMUTEX; i++) {
+		mask = disable();
+		mx = mutab[i];
+		restore(mask);
+		if (mx.mxstate == MX_FREE) {
+			continue;
+		}
+
+		/* Waits are in TSC cycles, or in clock ticks without a TSC */
+
+		if (tschz != 0) {
+			maxus = (uint32)udiv64(mx.mxmaxwait, tschz / 1000000,
+						NULL);
+		} else {
+			maxus = (uint32)mx.mxmaxwait * (1000000
+						/ CLKTICKS_PER_SEC);
+		}
+		if (mx.mxowner < 0) {
+			printf("%3d %-12s %5s %10u %8u %10u\n", i, mx.mxname,
+				"-", mx.mxlocks, mx.mxwaits, maxus);
+		} else {
+			printf("%3d %-12s %5d %10u %8u %10u\n", i, mx.mxname,
+				mx.mxowner, mx.mxlocks, mx.mxwaits, maxus);
+		}
+	}
+	return 0;
+}
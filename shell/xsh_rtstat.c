@@ -0,0 +1,61 @@
+/* xsh_rtstat.c - xsh_rtstat */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+/*------------------------------------------------------------------------
+ * xsh_rtstat - Print the parameters and deadline statistics of the EDF
+ *		processes
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_rtstat(int nargs, char *args[])
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	int32	i;
+	char *pstate[]	= {		/* names for process states	*/
+		"free ", "curr ", "ready", "recv ", "sleep", "susp ",
+		"wait ", "rtime", "mutex"};
+
+	/* For argument '--help', emit help about the 'rtstat' command	*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tLists the real-time processes scheduled earliest\n");
+		printf("\tdeadline first, with their period, budget and\n");
+		printf("\tdeadline in ms, the jobs they completed, the jobs\n");
+		printf("\tthat missed their deadline and the jobs stopped\n");
+		printf("\tfor exceeding their budget\n");
+		printf("Options:\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 1) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	printf("%3s %-16s %5s %6s %6s %6s %8s %6s %6s\n",
+		"Pid", "Name", "State", "Period", "Budget", "Dline",
+		"Jobs", "Missed", "Overrn");
+	for (i = 0; i < NPROC; i++) {
+		prptr = &proctab[i];
+		if (prptr->prstate == PR_FREE || prptr->prclass != PC_EDF) {
+			continue;
+		}
+		printf("%3d %-16s %s %6u %6u %6u %8u %6u %6u\n", i,
+			prptr->prname, pstate[(int)prptr->prstate],
+			prptr->prperiod, prptr->prbudget, prptr->prreldl,
+			prptr->prjobs, prptr->prmisses, prptr->proverruns);
+	}
+	printf("CPU reserved: %u.%u%% of %u.%u%% admitted\n",
+		edfutil / 10000, edfutil / 1000 % 10,
+		EDFMAXUTIL / 10000, EDFMAXUTIL / 1000 % 10);
+	return 0;
+}
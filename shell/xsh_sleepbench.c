@@ -0,0 +1,155 @@
+/* xsh_sleepbench.c - xsh_sleepbench, sleeper */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define	BENCHMS		2000		/* Length of each run in ms	*/
+#define	MAXDELAY	100		/* Longest sleep of a sleeper	*/
+
+extern	int	rand_r(unsigned int *);
+
+/*------------------------------------------------------------------------
+ * sleeper - Sleep or wait for a message with a timeout, over and over
+ *------------------------------------------------------------------------
+ */
+local	process	sleeper(
+	  uint32	seed		/* Seed of the delay sequence	*/
+	)
+{
+	int32	delay;			/* Ticks of the next wait	*/
+
+	while (TRUE) {
+		delay = 1 + rand_r(&seed) % MAXDELAY;
+		if (delay & 1) {
+			sleepms(delay);
+		} else {
+			recvtime(4 * delay);	/* Often cut short by send */
+		}
+	}
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * xsh_sleepbench - Run the same sleeper load on the timing wheel and on
+ *			the delta list and print what the sleep queue cost
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_sleepbench(int nargs, char *args[])
+{
+	int32	nprocs;			/* Sleepers to create		*/
+	pid32	pids[NPROC];		/* Their IDs			*/
+	int32	kind;			/* Design being measured	*/
+	int32	i, t;
+	char	*chptr;			/* Walks through argument	*/
+	char	ch;			/* Next character of argument	*/
+	intmask	mask;			/* Saved interrupt mask		*/
+	uint32	ticks, cyc, max, opcyc, ops;	/* Snapshot of counters	*/
+	unsigned int seed;		/* Picks the process to send to	*/
+
+	/* For argument '--help', emit help about the 'sleepbench' command*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s [nprocs]\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tCreates nprocs processes (default 80) that keep\n");
+		printf("\tsleeping or waiting for a message with a timeout\n");
+		printf("\tthat is often cut short, and runs them for %d ms\n",
+			BENCHMS);
+		printf("\ton the delta list, then on the timing wheel; for\n");
+		printf("\teach prints the CPU cycles the clock interrupt\n");
+		printf("\tspent on sleepers per tick and the cycles taken by\n");
+		printf("\teach insert or removal\n");
+		printf("Options:\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 2) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	nprocs = 80;
+	if (nargs == 2) {
+		chptr = args[1];
+		ch = *chptr++;
+		nprocs = 0;
+		while (ch != NULLCH) {
+			if ( (ch < '0') || (ch > '9') ) {
+				fprintf(stderr, "%s: nondigit in argument\n",
+					args[0]);
+				return 1;
+			}
+			nprocs = 10*nprocs + (ch - '0');
+			ch = *chptr++;
+		}
+		if (nprocs <= 0 || nprocs >= NPROC) {
+			fprintf(stderr, "%s: nprocs must be 1 to %d\n",
+				args[0], NPROC - 1);
+			return 1;
+		}
+	}
+
+	for (kind = SLP_DELTA; kind >= SLP_WHEEL; kind--) {
+		if (sleepswitch(kind) == SYSERR) {
+			fprintf(stderr, "%s: other processes are sleeping\n",
+				args[0]);
+			sleepswitch(SLP_WHEEL);
+			return 1;
+		}
+
+		/* Start every run from the same sleepers and counters	*/
+
+		for (i = 0; i < nprocs; i++) {
+			pids[i] = create(sleeper, 1024, getprio(getpid()),
+					"sleeper", 1, i + 1);
+			if (pids[i] == SYSERR) {
+				fprintf(stderr, "%s: cannot create sleepers\n",
+					args[0]);
+				while (--i >= 0) {
+					kill(pids[i]);
+				}
+				return 1;
+			}
+		}
+		mask = disable();
+		sleepcyc = sleepmax = sleepopcyc = sleepops = 0;
+		ticks = sleepbase;
+		restore(mask);
+		for (i = 0; i < nprocs; i++) {
+			resume(pids[i]);
+		}
+
+		/* Every tick, wake a timed receive early with a message	*/
+
+		seed = 1;
+		for (t = 0; t < BENCHMS; t++) {
+			sleepms(1);
+			send(pids[rand_r(&seed) % nprocs], 0);
+		}
+
+		mask = disable();
+		ticks = sleepbase - ticks;
+		cyc = sleepcyc;
+		max = sleepmax;
+		opcyc = sleepopcyc;
+		ops = sleepops;
+		restore(mask);
+		for (i = 0; i < nprocs; i++) {
+			kill(pids[i]);
+		}
+
+		printf("%s: %u ticks, %u cycles per tick (max %u), ",
+			kind == SLP_DELTA ? "delta list " : "timing wheel",
+			ticks, cyc / ticks, max);
+		printf("%u inserts/removals, %u cycles each\n",
+			ops, ops > 0 ? opcyc / ops : 0);
+	}
+	return 0;
+}
@@ -0,0 +1,185 @@
+/* xsh_top.c - xsh_top */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+/* CPU accounting of a process at one point in time */
+
+struct	topent	{
+	bool8	tpvalid;		/* Slot held a process		*/
+	uint64	tprun;			/* User plus kernel time	*/
+	uint64	tpkern;			/* Kernel time			*/
+	uint64	tpwait;			/* Time on the ready queue	*/
+	uint32	tpvolsw;		/* Voluntary switches		*/
+	uint32	tpinvolsw;		/* Involuntary switches		*/
+};
+
+local	struct	topent	topold[NPROC], topnew[NPROC];
+
+/*------------------------------------------------------------------------
+ * topsnap - Copy the CPU accounting of every process
+ *------------------------------------------------------------------------
+ */
+local	uint64	topsnap(
+	  struct topent	*snap		/* Array of NPROC entries	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	uint64	now;			/* Stamp of the snapshot	*/
+	int32	i;
+
+	mask = disable();
+	now = cpucharge();
+	for (i = 0; i < NPROC; i++) {
+		prptr = &proctab[i];
+		snap[i].tpvalid = prptr->prstate != PR_FREE;
+		snap[i].tprun = prptr->prusertime + prptr->prkerntime;
+		snap[i].tpkern = prptr->prkerntime;
+		snap[i].tpwait = prptr->prwaittime;
+		if (prptr->prstate == PR_READY) {
+			snap[i].tpwait += now - prptr->prreadyat;
+		}
+		snap[i].tpvolsw = prptr->prvolsw;
+		snap[i].tpinvolsw = prptr->prinvolsw;
+	}
+	restore(mask);
+	return now;
+}
+
+/*------------------------------------------------------------------------
+ * toppct - Share of part in whole, in tenths of a percent
+ *------------------------------------------------------------------------
+ */
+local	uint32	toppct(
+	  uint64	part,		/* Time of a process		*/
+	  uint64	whole		/* Length of the interval	*/
+	)
+{
+	while (whole > 0xffffffffULL / 1000) {
+		part >>= 1;
+		whole >>= 1;
+	}
+	if (whole == 0) {
+		return 0;
+	}
+	return (uint32)udiv64(part * 1000, (uint32)whole, NULL);
+}
+
+/*------------------------------------------------------------------------
+ * xsh_top - Print the processes using the most CPU time, refreshing
+ *		every few seconds
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_top(int nargs, char *args[])
+{
+	int32	delay;			/* Seconds between refreshes	*/
+	int32	count;			/* Refreshes to print		*/
+	int32	arg[2];			/* Values of the arguments	*/
+	char	*chptr;			/* Walks through argument	*/
+	char	ch;			/* Next character of argument	*/
+	uint64	start, now;		/* Stamps of the two snapshots	*/
+	uint64	run[NPROC];		/* Run time over the interval	*/
+	bool8	shown[NPROC];		/* Process already printed	*/
+	int32	i, j, k, best;
+	char *pstate[]	= {		/* names for process states	*/
+		"free ", "curr ", "ready", "recv ", "sleep", "susp ",
+		"wait ", "rtime", "mutex"};
+
+	/* For argument '--help', emit help about the 'top' command	*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s [seconds [count]]\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tEvery few seconds (default 2), count times\n");
+		printf("\t(default 5), lists the processes by the share of\n");
+		printf("\tthe CPU they used over the interval: total, in\n");
+		printf("\tinterrupt handlers (kernel) and waiting on the\n");
+		printf("\tready queue, with their voluntary and involuntary\n");
+		printf("\tcontext switches\n");
+		printf("Options:\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 3) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	arg[0] = 2;
+	arg[1] = 5;
+	for (i = 1; i < nargs; i++) {
+		chptr = args[i];
+		ch = *chptr++;
+		arg[i - 1] = 0;
+		while (ch != NULLCH) {
+			if ( (ch < '0') || (ch > '9') ) {
+				fprintf(stderr, "%s: nondigit in argument\n",
+					args[0]);
+				return 1;
+			}
+			arg[i - 1] = 10*arg[i - 1] + (ch - '0');
+			ch = *chptr++;
+		}
+		if (arg[i - 1] <= 0) {
+			fprintf(stderr, "%s: arguments must be positive\n",
+				args[0]);
+			return 1;
+		}
+	}
+	delay = arg[0];
+	count = arg[1];
+
+	for (k = 0; k < count; k++) {
+		start = topsnap(topold);
+		sleep(delay);
+		now = topsnap(topnew);
+
+		printf("\n%3s %-16s %5s %6s %6s %6s %8s %8s\n",
+			"Pid", "Name", "State", "%CPU", "%Kern", "%Wait",
+			"VolSw", "InvolSw");
+
+		/* Only processes that lived through the whole interval	*/
+
+		for (i = 0; i < NPROC; i++) {
+			shown[i] = !topold[i].tpvalid || !topnew[i].tpvalid;
+			run[i] = topnew[i].tprun - topold[i].tprun;
+		}
+
+		/* Highest CPU time first */
+
+		while (TRUE) {
+			best = -1;
+			for (j = 0; j < NPROC; j++) {
+				if (!shown[j] && (best < 0
+				    || run[j] > run[best])) {
+					best = j;
+				}
+			}
+			if (best < 0) {
+				break;
+			}
+			shown[best] = TRUE;
+			i = toppct(run[best], now - start);
+			j = toppct(topnew[best].tpkern - topold[best].tpkern,
+				now - start);
+			printf("%3d %-16s %s %4d.%d %4d.%d ", best,
+				proctab[best].prname,
+				pstate[(int)proctab[best].prstate],
+				i / 10, i % 10, j / 10, j % 10);
+			i = toppct(topnew[best].tpwait - topold[best].tpwait,
+				now - start);
+			printf("%4d.%d %8u %8u\n", i / 10, i % 10,
+				topnew[best].tpvolsw - topold[best].tpvolsw,
+				topnew[best].tpinvolsw
+					- topold[best].tpinvolsw);
+		}
+	}
+	return 0;
+}
@@ -15,13 +15,17 @@ shellcmd xsh_uptime(int nargs, char *args[])
 	uint32	secperday = 86400;	/* seconds in a day		*/
 	uint32	secperhr  =  3600;	/* seconds in an hour		*/
 	uint32	secpermin =    60;	/* seconds in a minute		*/	
+	uint32	ticks, irqs;		/* clock ticks and interrupts	*/
+	intmask	mask;			/* saved interrupt mask		*/
 
 	/* For argument '--help', emit help about the 'uptime' command	*/
 
 	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
 		printf("Use: %s\n\n", args[0]);
 		printf("Description:\n");
-		printf("\tDisplays time since the system booted\n");
+		printf("\tDisplays time since the system booted, and the\n");
+		printf("\tclock ticks elapsed versus the clock interrupts\n");
+		printf("\ttaken (fewer while the tick is stopped)\n");
 		printf("Options:\n");
 		printf("\t--help\t display this help and exit\n");
 		return 0;
@@ -36,7 +40,11 @@ shellcmd xsh_uptime(int nargs, char *args[])
 		return 1;
 	}
 
+	mask = disable();
 	secs = clktime;		/* total seconds since boot */
+	ticks = clkticks;
+	irqs = clkirqs;
+	restore(mask);
 
 	/* subtract number of whole days */
 
@@ -70,6 +78,12 @@ shellcmd xsh_uptime(int nargs, char *args[])
 		printf(" %d second(s) ", secs);
 	}
 	printf("\n");
+	printf("%u clock ticks elapsed, %u clock interrupts taken\n",
+		ticks, irqs);
+	if (tschz != 0) {
+		printf("TSC runs at %u kHz\n", tschz / 1000);
+	}
+	printf("%u FPU state switches on first use\n", fpuloads);
 
 	return 0;
 }
@@ -0,0 +1,61 @@
+/* xsh_vmstat.c - xsh_vmstat */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+/*------------------------------------------------------------------------
+ * xsh_vmstat - Print paging features in use, address space switches
+ *		and demand paging activity
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_vmstat(int nargs, char *args[])
+{
+	uint32	loads, skips;		/* snapshot of the CR3 counters	*/
+	uint32	faults;			/* pages backed on demand	*/
+	uint32	copies;			/* pages copied on write	*/
+	uint32	trims;			/* free heap pages given back	*/
+	intmask	mask;			/* saved interrupt mask		*/
+
+	/* For argument '--help', emit help about the 'vmstat' command	*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("use: %s \n\n", args[0]);
+		printf("Description:\n");
+		printf("\tDisplays the paging features in use and how many\n");
+		printf("\tcontext switches reloaded or kept CR3, and how\n");
+		printf("\tmany pages were backed on first touch or copied\n");
+		printf("\ton a write after fork, and how many heap pages\n");
+		printf("\tinside free blocks were given back.\n");
+		printf("Options:\n");
+		printf("\t--help\t\tdisplay this help and exit\n");
+		return 0;
+	}
+
+	/* Check for valid number of arguments */
+
+	if (nargs > 1) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	mask = disable();
+	loads = cr3loads;
+	skips = cr3skips;
+	faults = pgfaults;
+	copies = cowcopies;
+	trims = heaptrims;
+	restore(mask);
+
+	printf("4 MB pages:        %s\n", vm_pse ? "yes" : "no");
+	printf("global pages:      %s\n", vm_pge ? "yes" : "no");
+	printf("CR3 reloads:       %10u\n", loads);
+	printf("CR3 reloads saved: %10u\n", skips);
+	printf("demand page-ins:   %10u\n", faults);
+	printf("copy-on-write:     %10u\n", copies);
+	printf("heap pages freed:  %10u\n", trims);
+
+	return 0;
+}
@@ -0,0 +1,266 @@
+/* apic.c - apicinit, ioapicroute, lapictick, lapicpending, lapiconeshot,*/
+/*		lapicwake, lapicstart						*/
+
+#include <xinu.h>
+
+#define	MSR_TSCDEADLINE	0x6e0		/* TSC value that fires the timer*/
+#define	CPUIDX_TSCDL	0x01000000	/* CPUID leaf 1 ECX: TSC deadline*/
+
+uint32	lapictimer = LT_NONE;	/* Source of the clock tick		*/
+volatile uint32	*lapiceoi;	/* Local APIC EOI register, or NULL	*/
+
+local	uint32	lapicintv;	/* Periodic: timer counts per tick	*/
+local	uint32	lapicphase;	/* Counts of the tick under way when	*/
+				/*   the one-shot was started		*/
+local	uint32	lapicshot;	/* Count loaded for the one-shot	*/
+local	uint32	lapicfrac;	/* Counts of partial ticks left over	*/
+local	uint32	lapictpt;	/* Deadline: TSC cycles per tick	*/
+				/*   (each processor keeps the TSC	*/
+				/*   value of its next in cpnexttick)	*/
+local	uint64	lapicdead;	/* TSC value that ends the one-shot	*/
+
+/*------------------------------------------------------------------------
+ *  ioapicwrite  -  Write a register of the I/O APIC
+ *------------------------------------------------------------------------
+ */
+local	void	ioapicwrite(
+	  uint32	reg,		/* Register number		*/
+	  uint32	val		/* Value to write		*/
+	)
+{
+	ioapic[IOAPIC_SEL] = reg;
+	ioapic[IOAPIC_WIN] = val;
+}
+
+/*------------------------------------------------------------------------
+ *  lapicarm  -  Make the timer fire when the TSC reaches a value
+ *------------------------------------------------------------------------
+ */
+local	void	lapicarm(
+	  uint64	tsc		/* TSC value of the interrupt	*/
+	)
+{
+	asm volatile("wrmsr" : : "c"(MSR_TSCDEADLINE),
+			"a"((uint32)tsc), "d"((uint32)(tsc >> 32)));
+}
+
+/*------------------------------------------------------------------------
+ *  lapictimerinit  -  Start the local APIC timer with a 1 ms period, in
+ *		       TSC-deadline mode when the processor has it
+ *------------------------------------------------------------------------
+ */
+local	void	lapictimerinit(void)
+{
+	uint32	eax, ebx, ecx, edx;	/* Results of CPUID leaf 1	*/
+	uint64	start;			/* TSC when calibration started	*/
+
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+			: "a"(1));
+	lapic[LAPIC_TDCR] = TDCR_DIV16;
+	if (ecx & CPUIDX_TSCDL) {
+		lapictimer = LT_DEADLINE;
+		lapictpt = tschz / CLKTICKS_PER_SEC;
+		lapic[LAPIC_LVTT] = LVT_DEADLINE | IRQ_LTIMER;
+		cputab[0].cpnexttick = getcycles() + lapictpt;
+		lapicarm(cputab[0].cpnexttick);
+		return;
+	}
+
+	/* Count down from the top for 10 ms of the TSC to find the	*/
+	/*   rate of the timer					*/
+
+	lapic[LAPIC_LVTT] = LVT_MASKED | IRQ_LTIMER;
+	lapic[LAPIC_TICR] = 0xffffffff;
+	start = getcycles();
+	while (getcycles() - start < tschz / 100) {
+		;
+	}
+	lapicintv = (0xffffffff - lapic[LAPIC_TCCR]) / 10;
+	lapicfrac = 0;
+	lapictimer = LT_PERIODIC;
+	lapic[LAPIC_LVTT] = LVT_PERIODIC | IRQ_LTIMER;
+	lapic[LAPIC_TICR] = lapicintv;
+}
+
+/*------------------------------------------------------------------------
+ *  apicinit  -  Move interrupt delivery from the 8259 and the 8254 to
+ *		 the I/O APIC and the local APIC timer, when both APICs
+ *		 were found
+ *------------------------------------------------------------------------
+ */
+void	apicinit(void)
+{
+	int32	i, n;
+
+	if (lapic == NULL || ioapic == NULL || tschz == 0) {
+		return;			/* Keep the 8259 and the 8254	*/
+	}
+
+	/* Mask every input of the I/O APIC */
+
+	ioapic[IOAPIC_SEL] = IOAPIC_VER;
+	n = ((ioapic[IOAPIC_WIN] >> 16) & 0xff) + 1;
+	for (i = 0; i < n; i++) {
+		ioapicwrite(IOAPIC_REDTBL + 2 * i, RED_MASKED);
+		ioapicwrite(IOAPIC_REDTBL + 2 * i + 1, 0);
+	}
+
+	/* Silence the 8259 and the 8254; the local APIC stops taking	*/
+	/*   the output of the 8259 on its LINT0 pin			*/
+
+	girmask = 0xffff;
+	_8259_setirmask();
+	lapic[LAPIC_LINT0] = LVT_MASKED;
+	outb(CLKCNTL, 0x30);		/* Counter 0, mode 0, stopped	*/
+	outb(CLOCK0, 0);
+	outb(CLOCK0, 0);
+
+	/* From now on handlers acknowledge at the local APIC, and	*/
+	/*   set_evec routes the IRQs of devices through the I/O APIC	*/
+
+	lapiceoi = &lapic[LAPIC_EOI];
+	set_evec(IRQ_LTIMER, (uint32)clkdisp);
+	lapictimerinit();
+	kprintf("Clock: local APIC timer%s, IRQs through the I/O APIC\n",
+		lapictimer == LT_DEADLINE ? " (TSC deadline)" : "");
+}
+
+/*------------------------------------------------------------------------
+ *  ioapicroute  -  Deliver an ISA IRQ to the BSP at a vector, as an
+ *		    edge-triggered, active high interrupt
+ *------------------------------------------------------------------------
+ */
+void	ioapicroute(
+	  uint32	irq,		/* ISA IRQ number		*/
+	  uint32	vector		/* Vector of its handler	*/
+	)
+{
+	uint32	gsi;			/* I/O APIC input		*/
+
+	if (irq >= NISAIRQ) {
+		return;
+	}
+	gsi = irqgsi[irq];
+	ioapicwrite(IOAPIC_REDTBL + 2 * gsi + 1, cputab[0].cpapicid << 24);
+	ioapicwrite(IOAPIC_REDTBL + 2 * gsi, vector);
+}
+
+/*------------------------------------------------------------------------
+ *  lapictick  -  Arm the next periodic tick in TSC-deadline mode
+ *------------------------------------------------------------------------
+ */
+void	lapictick(void)
+{
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+
+	if (lapictimer == LT_DEADLINE) {
+		cpptr = cpuself();
+		cpptr->cpnexttick += lapictpt;
+		lapicarm(cpptr->cpnexttick);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  lapicpending  -  Tell whether a timer interrupt is waiting
+ *------------------------------------------------------------------------
+ */
+bool8	lapicpending(void)
+{
+	return (lapic[LAPIC_IRR + (IRQ_LTIMER / 32) * 4]
+			>> (IRQ_LTIMER % 32)) & 1;
+}
+
+/*------------------------------------------------------------------------
+ *  lapiconeshot  -  Replace the periodic tick by one interrupt on the
+ *		     tick boundary ticks ticks after the last tick
+ *------------------------------------------------------------------------
+ */
+void	lapiconeshot(			/* Assumes interrupts disabled	*/
+	  uint32	ticks		/* Ticks the one-shot spans	*/
+	)
+{
+	uint32	count;			/* Counts left in current tick	*/
+
+	if (lapictimer == LT_DEADLINE) {
+		lapicdead = cputab[0].cpnexttick
+				+ (uint64)(ticks - 1) * lapictpt;
+		lapicarm(lapicdead);
+		return;
+	}
+	count = lapic[LAPIC_TCCR];
+	lapicphase = count <= lapicintv ? lapicintv - count : 0;
+	lapicshot = ticks * lapicintv - lapicphase;
+	lapic[LAPIC_LVTT] = IRQ_LTIMER;	/* One-shot mode		*/
+	lapic[LAPIC_TICR] = lapicshot;
+}
+
+/*------------------------------------------------------------------------
+ *  lapicwake  -  Go back to the periodic tick after a one-shot and
+ *		  return the ticks that elapsed meanwhile
+ *------------------------------------------------------------------------
+ */
+uint32	lapicwake(			/* Assumes interrupts disabled	*/
+	  bool8		fired,		/* TRUE when the one-shot ran	*/
+					/*   out and interrupted	*/
+	  uint32	ticks		/* Ticks the one-shot spans	*/
+	)
+{
+	uint64	now;			/* TSC when cut short		*/
+	uint32	count;			/* Counts left in the one-shot	*/
+	uint32	counts;			/* Counts since the last tick	*/
+
+	if (lapictimer == LT_DEADLINE) {
+		if (!fired) {
+			now = getcycles();
+			if (now >= lapicdead) {
+				clkskip = TRUE;	/* Its interrupt is due	*/
+			} else {
+				ticks = (uint32)udiv64(now + lapictpt
+					- cputab[0].cpnexttick,
+					lapictpt, NULL);
+			}
+		}
+		cputab[0].cpnexttick += (uint64)ticks * lapictpt;
+		lapicarm(cputab[0].cpnexttick);
+		return ticks;
+	}
+
+	if (!fired) {
+		count = lapic[LAPIC_TCCR];
+		if (count == 0) {
+			clkskip = TRUE;		/* Its interrupt is due	*/
+		} else {
+			counts = lapicphase + lapicshot - count;
+			ticks = counts / lapicintv;
+			lapicfrac += counts % lapicintv;
+			if (lapicfrac >= lapicintv) {
+				lapicfrac -= lapicintv;
+				ticks++;
+			}
+		}
+	}
+	lapic[LAPIC_LVTT] = LVT_PERIODIC | IRQ_LTIMER;
+	lapic[LAPIC_TICR] = lapicintv;
+	return ticks;
+}
+
+/*------------------------------------------------------------------------
+ *  lapicstart  -  Start the local APIC timer of an application processor
+ *		   with the tick the BSP measured
+ *------------------------------------------------------------------------
+ */
+void	lapicstart(void)
+{
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+
+	lapic[LAPIC_TDCR] = TDCR_DIV16;
+	if (lapictimer == LT_DEADLINE) {
+		cpptr = cpuself();
+		lapic[LAPIC_LVTT] = LVT_DEADLINE | IRQ_LTIMER;
+		cpptr->cpnexttick = getcycles() + lapictpt;
+		lapicarm(cpptr->cpnexttick);
+		return;
+	}
+	lapic[LAPIC_LVTT] = LVT_PERIODIC | IRQ_LTIMER;
+	lapic[LAPIC_TICR] = lapicintv;
+}
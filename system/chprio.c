@@ -21,8 +21,9 @@ pri16	chprio(
 		return (pri16) SYSERR;
 	}
 	prptr = &proctab[pid];
-	oldprio = prptr->prprio;
-	prptr->prprio = newprio;
+	oldprio = prptr->prbaseprio;
+	prptr->prbaseprio = newprio;
+	mutexprio(pid);			/* Keep inherited priority	*/
 	restore(mask);
 	return oldprio;
 }
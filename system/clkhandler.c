@@ -1,4 +1,4 @@
-/* clkhandler.c - clkhandler */
+/* clkhandler.c - clkhandler, clkadvance */
 
 #include <xinu.h>
 
@@ -8,36 +8,92 @@
  */
 void	clkhandler(void)
 {
-	/* Decrement the ms counter, and see if a second has passed */
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
 
-	if((++count1000) >= 1000) {
+	/* An application processor only charges the tick to the	*/
+	/*   process it runs; the BSP keeps the time for all		*/
 
-		/* One second has passed, so increment seconds count */
+	cpptr = cpuself();
+	if (cpptr->cpindex != 0) {
+		lapictick();
+		edftick();
+		if((--cpptr->cppreempt) <= 0) {
+			cpptr->cppreempt = QUANTUM;
+			resched();
+		}
+		return;
+	}
 
-		clktime++;
+	clkirqs++;
 
-		/* Reset the local ms counter for the next second */
+	/* The ticks of a one-shot that ran out while it was being	*/
+	/*   cancelled have been accounted already			*/
 
-		count1000 = 0;
+	if (clkskip) {
+		clkskip = FALSE;
+		return;
 	}
 
-	/* Handle sleeping processes if any exist */
+	if (clktickless != 0) {
+
+		/* The one-shot ran out: account for the ticks it spanned */
+		/*   and go back to a periodic tick			  */
+
+		clkwake(TRUE);
+	} else {
+		lapictick();
+		clkadvance(1);
+
+		/* Hold back an EDF process that used up its budget */
+
+		edftick();
 
-	if(!isempty(sleepq)) {
+		/* Steer the TSC time toward the clock once a second */
 
-		/* Decrement the delay for the first process on the	*/
-		/*   sleep queue, and awaken if the count reaches zero	*/
+		if (count1000 == 0) {
+			tscsync();
+		}
+
+		/* Decrement the preemption counter, and reschedule when */
+		/*   the remaining time reaches zero			 */
 
-		if((--queuetab[firstid(sleepq)].qkey) <= 0) {
-			wakeup();
+		if((--cpptr->cppreempt) <= 0) {
+			cpptr->cppreempt = QUANTUM;
+			resched();
 		}
 	}
 
-	/* Decrement the preemption counter, and reschedule when the */
-	/*   remaining time reaches zero			     */
+	/* Stop the tick again if a single process can run		*/
+
+	clkstop();
+}
+
+/*------------------------------------------------------------------------
+ * clkadvance - Account for clock ticks that have elapsed
+ *------------------------------------------------------------------------
+ */
+void	clkadvance(
+	  uint32	ticks		/* Number of ticks elapsed	*/
+	)
+{
+	while (ticks-- > 0) {
+		clkticks++;
+
+		/* Increment the ms counter, and see if a second has passed */
+
+		if((++count1000) >= 1000) {
+
+			/* One second has passed, so increment seconds count */
+
+			clktime++;
+
+			/* Reset the local ms counter for the next second */
+
+			count1000 = 0;
+		}
+
+		/* Awaken sleeping processes whose delay has run out */
 
-	if((--preempt) <= 0) {
-		preempt = QUANTUM;
-		resched();
+		sleeptick();
 	}
 }
@@ -0,0 +1,142 @@
+/* clkidle.c - clkstop, clkwake */
+
+#include <xinu.h>
+
+#define	PIC1		0x20		/* Master interrupt controller	*/
+#define	PIC_READIRR	0x0a		/* OCW3: read request register	*/
+
+uint32	clktickless;		/* Ticks the one-shot spans, 0 if none	*/
+bool8	clkskip;		/* Next clock interrupt was accounted	*/
+uint32	clkticks;		/* Ticks elapsed since boot		*/
+uint32	clkirqs;		/* Clock interrupts taken since boot	*/
+
+local	uint32	clkphase;	/* Counts of the tick under way when	*/
+				/*   the one-shot was started		*/
+local	uint32	clkshot;	/* Count loaded for the one-shot	*/
+local	uint32	clkfrac;	/* Counts of partial ticks left over	*/
+				/*   when one-shots were cut short	*/
+
+/*------------------------------------------------------------------------
+ *  clkstop  -  Replace the periodic tick by a one-shot count up to the
+ *		next sleep deadline when at most one process can run;
+ *		only a uniprocessor does, as the BSP keeps the time
+ *------------------------------------------------------------------------
+ */
+void	clkstop(void)			/* Assumes interrupts disabled	*/
+{
+	struct	cpuent	*cpptr;		/* Entry of the BSP		*/
+	uint32	ticks;			/* Ticks the one-shot spans	*/
+	uint32	count;			/* Counts left in current tick	*/
+
+	if (clktickless != 0 || ncpuonline > 1) {
+		return;
+	}
+
+	/* Nothing but the null process may be waiting to run, or the	*/
+	/*   current process would need preempting; an EDF process	*/
+	/*   needs every tick charged to its budget			*/
+
+	cpptr = &cputab[0];
+	if (proctab[currpid].prclass == PC_EDF
+	    || cpptr->cpreadymap > 1 || (cpptr->cpreadymap == 1
+	    && (firstid(readyq(cpptr, 0)) != NULLPROC
+		|| lastid(readyq(cpptr, 0)) != NULLPROC))) {
+		return;
+	}
+	ticks = sleepnext(lapictimer != LT_NONE ? LAPICMAXIDLE : CLKMAXIDLE);
+	if (ticks < 2) {
+		return;
+	}
+
+	/* The local APIC timer, when it gives the tick, does the same	*/
+
+	if (lapictimer != LT_NONE) {
+		if (lapicpending()) {
+			return;
+		}
+		lapiconeshot(ticks);
+		clktickless = ticks;
+		return;
+	}
+
+	/* A tick that is already pending must be taken periodically	*/
+
+	outb(PIC1, PIC_READIRR);
+	if (inb(PIC1) & 0x01) {
+		return;
+	}
+
+	/* Latch the count of the tick under way so that the one-shot	*/
+	/*   ends on a tick boundary					*/
+
+	outb(CLKCNTL, 0x00);
+	count = inb(CLOCK0) & 0xff;
+	count |= (inb(CLOCK0) & 0xff) << 8;
+	clkphase = count <= CLKINTV ? CLKINTV - count : 0;
+	clkshot = ticks * CLKINTV - clkphase;
+
+	outb(CLKCNTL, 0x30);		/* Counter 0, mode 0 (one-shot)	*/
+	outb(CLOCK0, (char) (0xff & clkshot));
+	outb(CLOCK0, (char) (0xff & (clkshot >> 8)));
+	clktickless = ticks;
+}
+
+/*------------------------------------------------------------------------
+ *  clkwake  -  Go back to the periodic tick after a one-shot, and
+ *		account for the ticks that elapsed meanwhile
+ *------------------------------------------------------------------------
+ */
+void	clkwake(			/* Assumes interrupts disabled	*/
+	  bool8		fired		/* TRUE when the one-shot ran	*/
+	)				/*   out and interrupted	*/
+{
+	uint32	ticks;			/* Ticks to account for		*/
+	uint32	counts;			/* Counts since the last tick	*/
+	uint32	count;			/* Counts left in the one-shot	*/
+	int32	status;			/* Status of counter 0		*/
+
+	if (clktickless == 0) {
+		return;
+	}
+	ticks = clktickless;
+
+	if (lapictimer != LT_NONE) {
+		clktickless = 0;
+		cputab[0].cppreempt = QUANTUM;
+		clkadvance(lapicwake(fired, ticks));
+		return;
+	}
+
+	if (!fired) {
+
+		/* Cut short by another interrupt: read back the status	*/
+		/*   and count of counter 0 to see how far it got	*/
+
+		outb(CLKCNTL, 0xc2);
+		status = inb(CLOCK0);
+		count = inb(CLOCK0) & 0xff;
+		count |= (inb(CLOCK0) & 0xff) << 8;
+		if (status & 0x80) {
+
+			/* Ran out already; its interrupt is pending	*/
+
+			clkskip = TRUE;
+		} else {
+			counts = clkphase + clkshot - count;
+			ticks = counts / CLKINTV;
+			clkfrac += counts % CLKINTV;
+			if (clkfrac >= CLKINTV) {
+				clkfrac -= CLKINTV;
+				ticks++;
+			}
+		}
+	}
+	clktickless = 0;
+
+	outb(CLKCNTL, 0x34);		/* Counter 0, mode 2 (periodic)	*/
+	outb(CLOCK0, (char) (0xff & CLKINTV));
+	outb(CLOCK0, (char) (0xff & (CLKINTV >> 8)));
+
+	cputab[0].cppreempt = QUANTUM;
+	clkadvance(ticks);
+}
@@ -5,7 +5,6 @@
 uint32	clktime;		/* Seconds since boot			*/
 uint32	count1000;		/* Milliseconds since last clock tick   */
 qid16	sleepq;			/* Queue of sleeping processes		*/
-uint32	preempt;		/* Preemption counter			*/
 
 /*------------------------------------------------------------------------
  * clkinit  -  Initialize the clock and sleep queue at startup (x86)
@@ -14,18 +13,33 @@ uint32	preempt;		/* Preemption counter			*/
 void	clkinit(void)
 {
 	uint16	intv;		/* Clock rate in KHz			*/
+	int32	i;
 	/* Allocate a queue to hold the delta list of sleeping processes*/
+	/*   and the queues of the timing wheel, which is used first	*/
 
 	sleepq = newqueue();
+	sleepwheel = newqueue();
+	for (i = 1; i < SLPLEVELS * SLPSLOTS; i++) {
+		newqueue();
+	}
+	sleepbase = 0;
+	sleepkind = SLP_WHEEL;
 
-	/* Initialize the preemption count */
+	/* Start with a periodic tick */
 
-	preempt = QUANTUM;
+	clktickless = 0;
+	clkskip = FALSE;
+	clkticks = 0;
+	clkirqs = 0;
 
 	/* Initialize the time since boot to zero */
 
 	clktime = 0;
         count1000 = 0;
+	/* Measure the TSC against the clock chip before starting it	*/
+
+	tscinit();
+
 	/* Set interrupt vector for the clock to invoke clkdisp */
 	set_evec(IRQBASE, (uint32)clkdisp);
 
@@ -33,7 +47,7 @@ void	clkinit(void)
 
 	/* Set the clock rate to 1.190 Mhz; this is 1 ms interrupt rate */
 
-	intv = 1193;	/* Using 1193 instead of 1190 to fix clock skew	*/
+	intv = CLKINTV;	/* Using 1193 instead of 1190 to fix clock skew	*/
 
 	/* Must write LSB first, then MSB */
 
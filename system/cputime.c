@@ -0,0 +1,75 @@
+/* cputime.c - cpustamp, cpucharge, cpuclear, intrenter, intrexit */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ *  cpustamp  -  Time stamp for CPU accounting: TSC cycles if there is
+ *		 a TSC, clock ticks otherwise
+ *------------------------------------------------------------------------
+ */
+uint64	cpustamp(void)
+{
+	return tschz != 0 ? getcycles() : (uint64)clkticks;
+}
+
+/*------------------------------------------------------------------------
+ *  cpucharge  -  Charge the time since the last charge on this processor
+ *		  to the current process and return the current stamp
+ *------------------------------------------------------------------------
+ */
+uint64	cpucharge(void)			/* Assumes interrupts disabled	*/
+{
+	struct	procent	*prptr;		/* Ptr to current process entry	*/
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+	uint64	now;			/* Current stamp		*/
+
+	now = cpustamp();
+	prptr = &proctab[currpid];
+	cpptr = cpuself();
+	if (prptr->printr > 0) {
+		prptr->prkerntime += now - cpptr->cpcharged;
+	} else {
+		prptr->prusertime += now - cpptr->cpcharged;
+	}
+	cpptr->cpcharged = now;
+	return now;
+}
+
+/*------------------------------------------------------------------------
+ *  cpuclear  -  Clear the CPU accounting of a new process
+ *------------------------------------------------------------------------
+ */
+void	cpuclear(
+	  struct procent *prptr		/* Entry of the new process	*/
+	)
+{
+	prptr->prusertime = 0;
+	prptr->prkerntime = 0;
+	prptr->prwaittime = 0;
+	prptr->prreadyat = 0;
+	prptr->prvolsw = 0;
+	prptr->prinvolsw = 0;
+	prptr->printr = 0;
+}
+
+/*------------------------------------------------------------------------
+ *  intrenter  -  Called by interrupt dispatchers before the handler;
+ *		  the interrupted process is charged kernel time until
+ *		  the matching intrexit, even across context switches
+ *------------------------------------------------------------------------
+ */
+void	intrenter(void)			/* Assumes interrupts disabled	*/
+{
+	cpucharge();
+	proctab[currpid].printr++;
+}
+
+/*------------------------------------------------------------------------
+ *  intrexit  -  Called by interrupt dispatchers after the handler
+ *------------------------------------------------------------------------
+ */
+void	intrexit(void)			/* Assumes interrupts disabled	*/
+{
+	cpucharge();
+	proctab[currpid].printr--;
+}
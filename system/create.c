@@ -1,8 +1,7 @@
-/* create.c - create, newpid */
+/* create.c - create, createargs, newpid */
 
 #include <xinu.h>
 
-local int newpid();
 
 extern struct page *GetOnePage(void);
 extern char *allocstk(
@@ -19,6 +18,23 @@ pid32 create(
 	char *name,		/* Name (for debugging)		*/
 	uint32 nargs,	/* Number of args that follow	*/
 	...)
+{
+	return createargs(funcaddr, ssize, priority, name, nargs,
+					  (uint32 *)(&nargs + 1));
+}
+
+/*------------------------------------------------------------------------
+ *  createargs  -  Create a process given the address of its arguments
+ *		   (the work of create, shared with create_rt)
+ *------------------------------------------------------------------------
+ */
+pid32 createargs(
+	void *funcaddr, /* Address of the function	*/
+	uint32 ssize,	/* Stack size in bytes		*/
+	pri16 priority, /* Process priority > 0		*/
+	char *name,		/* Name (for debugging)		*/
+	uint32 nargs,	/* Number of args		*/
+	uint32 *args)	/* The args, first one first	*/
 {
 	uint32 savsp, *pushsp;
 	intmask mask;		   /* Interrupt mask		*/
@@ -71,19 +87,27 @@ pid32 create(
 	prptr->prdesc[1] = CONSOLE;
 	prptr->prdesc[2] = CONSOLE;
 
-	prptr->freelistptr = NULL;
+	memset(prptr->freelists, 0, sizeof(prptr->freelists));
+	prptr->freemap = 0;
 	prptr->maxheap = KERNEL_END;
+	cpuclear(prptr);
+	prptr->prfpu = NULL;		/* Until it uses the FPU	*/
+	prptr->prclass = PC_PRIO;
+	prptr->prbaseprio = prptr->prprio;
+	prptr->prmutex = prptr->prheld = -1;
+	prptr->prcpu = getcpu();	/* First ready where created	*/
+	prptr->prreq = 0;
 
 	/* Initialize stack as if the process was called		*/
 
 	uint32 *saddr_cp = saddr;
-	saddr = (uint32 *)0x1fffffc;
+	saddr = (uint32 *)phys_to_virt(VirtToPhys(prptr->phypgdir, (uint32)saddr)); /* top stack word through the direct map */
 	*saddr = STACKMAGIC;
 	savsp = (uint32)saddr_cp;
 
 	uint32 obj;
 	/* Push arguments */
-	a = (uint32 *)(&nargs + 1); /* Start of args		*/
+	a = args;					/* Start of args		*/
 	a += nargs - 1;				/* Last argument		*/
 	for (; nargs > 0; nargs--)	/* Machine dependent; copy args	*/
 	{
@@ -102,12 +126,16 @@ pid32 create(
 	/*   ctxsw that "returns" to the*/
 	/*   new process		*/
 	--saddr_cp;
+	*--saddr = (long)procstart; /* ... by way of procstart,	*/
+	/*   which releases the kernel	*/
+	/*   lock resched holds		*/
+	--saddr_cp;
 	*--saddr = (uint32)prptr->prstkbase; /* This will be register ebp	*/
 	/*   for process exit		*/
 	--saddr_cp;
 	savsp = (uint32)saddr_cp; /* Start of frame for ctxsw	*/
-	*--saddr = 0x00000200;	  /* New process runs with	*/
-	/*   interrupts enabled		*/
+	*--saddr = 0;			  /* Interrupts stay disabled	*/
+	/*   until procstart		*/
 	--saddr_cp;
 	/* Basically, the following emulates an x86 "pushal" instruction*/
 
@@ -141,7 +169,7 @@ pid32 create(
  *  newpid  -  Obtain a new (free) process ID
  *------------------------------------------------------------------------
  */
-local pid32 newpid(void)
+pid32 newpid(void)
 {
 	uint32 i;				  /* Iterate through all processes*/
 	static pid32 nextpid = 1; /* Position in table to try or	*/
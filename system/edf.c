@@ -0,0 +1,147 @@
+/* edf.c - create_rt, rtwait, edftick, edffree */
+
+#include <xinu.h>
+
+uint32	edfutil;		/* CPU share reserved by EDF processes,	*/
+				/*   in parts per million		*/
+
+/*------------------------------------------------------------------------
+ *  edfnext  -  End the current job of an EDF process: count a miss if
+ *		it was late, and wait for the release of the next job
+ *------------------------------------------------------------------------
+ */
+local	void	edfnext(		/* Assumes interrupts disabled	*/
+	  pid32		pid,		/* ID of the current process	*/
+	  bool8		overrun		/* Job used up its budget	*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	int32	delay;			/* Ticks until the next release	*/
+
+	prptr = &proctab[pid];
+	if (overrun || (int32)(clkticks - prptr->prdeadline) > 0) {
+		prptr->prmisses++;
+	}
+	delay = (int32)(prptr->prrelease - clkticks);
+	prptr->prdeadline = prptr->prrelease + prptr->prreldl;
+	prptr->prrelease += prptr->prperiod;
+	prptr->prleft = prptr->prbudget;
+
+	/* A process that has fallen behind runs its next job at once	*/
+
+	if (delay > 0 && sleepinsert(pid, delay) != SYSERR) {
+		prptr->prstate = PR_SLEEP;
+	}
+	resched();
+}
+
+/*------------------------------------------------------------------------
+ *  create_rt  -  Create a periodic real-time process scheduled earliest
+ *		  deadline first; times are in clock ticks, and the first
+ *		  job is released at once
+ *------------------------------------------------------------------------
+ */
+pid32	create_rt(
+	  void		*funcaddr,	/* Address of the function	*/
+	  uint32	period,		/* Time between job releases	*/
+	  uint32	budget,		/* CPU time each job may use	*/
+	  uint32	deadline,	/* Deadline after each release	*/
+	  uint32	ssize,		/* Stack size in bytes		*/
+	  char		*name,		/* Name (for debugging)		*/
+	  uint32	nargs,		/* Number of args that follow	*/
+	  ...
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	uint32	density;		/* CPU share the process needs	*/
+	pid32	pid;			/* ID of the new process	*/
+
+	if (period == 0 || budget == 0 || deadline == 0
+	    || budget > deadline || deadline > period) {
+		return SYSERR;
+	}
+	density = (uint32)udiv64((uint64)budget * 1000000, deadline, NULL);
+
+	/* Admission: EDF meets every deadline while the densities add	*/
+	/*   up to at most 1; keep a share for the other processes	*/
+
+	mask = disable();
+	if (edfutil + density > EDFMAXUTIL) {
+		restore(mask);
+		return SYSERR;
+	}
+	pid = createargs(funcaddr, ssize, EDFPRIO, name, nargs,
+					(uint32 *)(&nargs + 1));
+	if (pid == SYSERR) {
+		restore(mask);
+		return SYSERR;
+	}
+	prptr = &proctab[pid];
+	prptr->prclass = PC_EDF;
+	prptr->prperiod = period;
+	prptr->prbudget = budget;
+	prptr->prreldl = deadline;
+	prptr->prdensity = density;
+	prptr->prdeadline = clkticks + deadline;
+	prptr->prrelease = clkticks + period;
+	prptr->prleft = budget;
+	prptr->prjobs = prptr->prmisses = prptr->proverruns = 0;
+	edfutil += density;
+	restore(mask);
+	return pid;
+}
+
+/*------------------------------------------------------------------------
+ *  rtwait  -  Complete the current job of the calling EDF process and
+ *	       sleep until the next one is released
+ *------------------------------------------------------------------------
+ */
+syscall	rtwait(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+
+	mask = disable();
+	prptr = &proctab[currpid];
+	if (prptr->prclass != PC_EDF) {
+		restore(mask);
+		return SYSERR;
+	}
+	prptr->prjobs++;
+	edfnext(currpid, FALSE);
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  edftick  -  Charge a clock tick to the budget of a running EDF
+ *		process, and hold it back until its next release when
+ *		the budget runs out
+ *------------------------------------------------------------------------
+ */
+void	edftick(void)			/* Assumes interrupts disabled	*/
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+
+	prptr = &proctab[currpid];
+	if (prptr->prclass != PC_EDF || --prptr->prleft > 0) {
+		return;
+	}
+	prptr->proverruns++;
+	edfnext(currpid, TRUE);
+}
+
+/*------------------------------------------------------------------------
+ *  edffree  -  Give back the CPU share of an EDF process being killed
+ *------------------------------------------------------------------------
+ */
+void	edffree(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of the process		*/
+	)
+{
+	if (proctab[pid].prclass == PC_EDF) {
+		edfutil -= proctab[pid].prdensity;
+		proctab[pid].prdensity = 0;
+	}
+}
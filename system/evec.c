@@ -34,8 +34,11 @@ uint16	girmask;
 #define	EOI	0x20		/* non-specific end of interrupt	*/
 
 #define NID		48	/* Number of interrupt descriptors	*/
+#define	IDT_NM		7	/* Device not available exception	*/
+#define	IDT_PF		14	/* Page fault exception			*/
 #define	IGDT_TRAPG	15	/* Trap Gate				*/
 #define	IGDT_INTRG	0xe	/* Interrupt Gate			*/
+#define	IGDT_TASKG	0x5	/* Task Gate				*/
 
 void	_8259_setirmask(void);	/* Set interrupt mask			*/
 
@@ -43,6 +46,18 @@ void	_8259_setirmask(void);	/* Set interrupt mask			*/
 extern	struct	idt idt[NID];	/* Interrupt descriptor table		*/
 extern	long	defevec[];	/* Default exception vector		*/
 
+uint32	pfstk[NCPU][PFSTK / sizeof(uint32)];
+				/* Page fault task stack of each CPU	*/
+
+/* A page fault on an unbacked stack page happens with %esp in that	*/
+/*   page, so the CPU cannot push an exception frame there. Vector	*/
+/*   14 is a task gate instead: the CPU saves the faulting process	*/
+/*   in the cptssmain of its cputab entry and runs Xpftask on its	*/
+/*   pfstk. The gate names TSS_PF, which the GDT of each processor	*/
+/*   points at that processor's cptsspf.				*/
+
+local	void	initpftask(void);
+
 /*------------------------------------------------------------------------
  * initevec  -  Initialize exception vectors to a default handler
  *------------------------------------------------------------------------
@@ -58,6 +73,7 @@ int32	initevec()
 	for(i = 0; i < NID; i++) {
 		set_evec(i, defevec[i]);
 	}
+	initpftask();
 
 	/* Load the interrupt descriptor table */
 
@@ -106,8 +122,13 @@ int32	set_evec(uint32 xnum, uint32 handler)
 	pidt->igd_hoffset = handler >> 16;
 
 	if (xnum > 31 && xnum < 48) {
-		/* Enable the interrupt in the global IR mask */
 		xnum -= 32;
+		if (lapiceoi != NULL) {
+			/* The I/O APIC delivers device IRQs instead */
+			ioapicroute(xnum, xnum + 32);
+			return OK;
+		}
+		/* Enable the interrupt in the global IR mask */
 		girmask &= ~(1<<xnum);
 		_8259_setirmask();	/* Pass it to the hardware */
 	}
@@ -116,6 +137,66 @@ int32	set_evec(uint32 xnum, uint32 handler)
 }
 
 
+/*------------------------------------------------------------------------
+ * initpftask  -  Route page faults to a task with its own stack
+ *------------------------------------------------------------------------
+ */
+local	void	initpftask(void)
+{
+	struct	idt	*pidt;
+
+	tssinit(0);
+
+	pidt = &idt[IDT_PF];
+	pidt->igd_loffset = 0;
+	pidt->igd_segsel = TSS_PF;
+	pidt->igd_mbz = 0;
+	pidt->igd_type = IGDT_TASKG;
+	pidt->igd_dpl = 0;
+	pidt->igd_present = 1;
+	pidt->igd_hoffset = 0;
+
+	/* Every task switch, and resched, sets CR0.TS, so the next	*/
+	/*   floating point instruction traps; fputrap clears it and	*/
+	/*   loads the FPU state of the process if another one's is in	*/
+
+	set_evec(IDT_NM, (uint32)Xfpu);
+}
+
+/*------------------------------------------------------------------------
+ * tssinit  -  Set up the task state segments of a processor and make
+ *	       the running code its kernel task
+ *------------------------------------------------------------------------
+ */
+void	tssinit(
+	  int32		cpu		/* Index of the processor	*/
+	)
+{
+	struct	tss	*tssmain;	/* State of the running process	*/
+	struct	tss	*tsspf;		/* State of the fault handler	*/
+
+	tssmain = &cputab[cpu].cptssmain;
+	tsspf = &cputab[cpu].cptsspf;
+	memset(tssmain, 0, sizeof(struct tss));
+	tssmain->tss_iomap = sizeof(struct tss);
+	memset(tsspf, 0, sizeof(struct tss));
+	tsspf->tss_iomap = sizeof(struct tss);
+	tsspf->tss_cr3 = KERNEL_PGDIR;
+	tsspf->tss_eip = (uint32)Xpftask;
+	tsspf->tss_eflags = 0x00000002;	/* Interrupts stay disabled	*/
+	tsspf->tss_esp = (uint32)&pfstk[cpu][PFSTK / sizeof(uint32)];
+	tsspf->tss_ebp = tsspf->tss_esp;
+	tsspf->tss_cs = 0x8;
+	tsspf->tss_ds = tsspf->tss_es = tsspf->tss_gs = 0x10;
+	tsspf->tss_fs = KSEG_CPU;	/* PageFault reads currpid	*/
+	tsspf->tss_ss = 0x18;
+
+	/* The running code becomes the kernel task; from now on the	*/
+	/*   CPU saves it into cptssmain whenever a page fault occurs	*/
+
+	asm volatile("ltr %w0" : : "r"(TSS_MAIN));
+}
+
 /*------------------------------------------------------------------------
  * _8259_setirmask  -  Set the interrupt mask in the controller
  *------------------------------------------------------------------------
@@ -0,0 +1,74 @@
+/* fork.c - fork */
+
+#include <xinu.h>
+
+extern void deallocstk(uint32);
+
+/*------------------------------------------------------------------------
+ *  fork  -  Create a process that is a copy of the calling one; the heap
+ *		and stack are shared copy-on-write, so a frame is only
+ *		copied when one of the two processes writes to it
+ *------------------------------------------------------------------------
+ */
+pid32	fork(void)
+{
+	intmask	mask;			/* Interrupt mask		*/
+	pid32	pid;			/* Stores new process id	*/
+	struct	procent *parent;	/* Ptr to the caller's entry	*/
+	struct	procent *prptr;		/* Ptr to the child's entry	*/
+	struct	page	*pgdir;		/* Child's page directory	*/
+
+	mask = disable();
+	parent = &proctab[currpid];
+	if (isidlepid(currpid) || (pid = newpid()) == SYSERR) {
+		restore(mask);
+		return SYSERR;
+	}
+	if ((pgdir = GetPages(0)) == NULL) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	/* The child starts out with the caller's process table entry	*/
+
+	prptr = &proctab[pid];
+	*prptr = *parent;
+	prptr->prstate = PR_SUSP;
+	prptr->prsem = -1;
+	prptr->prparent = currpid;
+	prptr->prhasmsg = FALSE;
+	prptr->prreq = 0;
+	prptr->phypgdir = (uint32)pgdir;
+	cpuclear(prptr);
+	prptr->prprio = prptr->prbaseprio;	/* Holds no mutexes	*/
+	prptr->prmutex = prptr->prheld = -1;
+	if (prptr->prclass == PC_EDF) {	/* Reservations are not shared	*/
+		prptr->prclass = PC_PRIO;
+		prptr->prprio = prptr->prbaseprio = INITPRIO;
+	}
+	if (fpufork(pid) == SYSERR) {
+		FreeOnePage(pgdir);
+		prptr->prstate = PR_FREE;
+		restore(mask);
+		return SYSERR;
+	}
+
+	/* The child resumes here, with forkctx returning 0		*/
+
+	if (forkctx(&prptr->prstkptr, pid) == SYSERR) {
+		deallocstk(prptr->phypgdir);
+		fpufree(pid);
+		prptr->prstate = PR_FREE;
+		restore(mask);
+		return SYSERR;
+	}
+	if (currpid == pid) {
+		restore(mask);
+		return 0;
+	}
+
+	prcount++;
+	ready(pid);
+	restore(mask);
+	return pid;
+}
@@ -0,0 +1,200 @@
+/* fpu.c - fpuinit, fpucpuinit, fputrap, fpuswitch, fpufork, fpufree */
+
+#include <xinu.h>
+
+uint32	fpuloads;		/* States loaded on an #NM trap		*/
+
+local	cid32	fpucache;	/* Object cache of FPU save areas	*/
+local	char	fpuclean[FPU_SAVESIZE] __attribute__((aligned(16)));
+				/* State every process starts with	*/
+
+/*------------------------------------------------------------------------
+ *  fpusave  -  Save the FPU (and SSE) registers in a save area
+ *------------------------------------------------------------------------
+ */
+local	void	fpusave(
+	  char		*area		/* 16-byte aligned save area	*/
+	)
+{
+	if (cpufeatures & CPUID_FXSR) {
+		asm volatile("fxsave (%0)" : : "r"(area) : "memory");
+	} else {
+		asm volatile("fnsave (%0)" : : "r"(area) : "memory");
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  fpurestore  -  Load the FPU (and SSE) registers from a save area
+ *------------------------------------------------------------------------
+ */
+local	void	fpurestore(
+	  char		*area		/* 16-byte aligned save area	*/
+	)
+{
+	if (cpufeatures & CPUID_FXSR) {
+		asm volatile("fxrstor (%0)" : : "r"(area) : "memory");
+	} else {
+		asm volatile("frstor (%0)" : : "r"(area) : "memory");
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  fpuinit  -  Enable the FPU and SSE and record their initial state
+ *------------------------------------------------------------------------
+ */
+void	fpuinit(void)
+{
+	fpucpuinit();
+	fpusave(fpuclean);
+	fpuloads = 0;
+	fpucache = cache_create(FPU_SAVESIZE, 16);
+	fpuswitch(currpid);
+}
+
+/*------------------------------------------------------------------------
+ *  fpucpuinit  -  Enable the FPU and SSE of the running processor and
+ *		   reset them, with no process owning them yet
+ *------------------------------------------------------------------------
+ */
+void	fpucpuinit(void)
+{
+	uint32	cr0, cr4;		/* Control registers		*/
+
+	asm volatile("movl %%cr0, %0" : "=r"(cr0));
+	cr0 = (cr0 & ~CR0_EM) | CR0_MP | CR0_NE;
+	asm volatile("movl %0, %%cr0" : : "r"(cr0));
+	if (cpufeatures & CPUID_FXSR) {
+		asm volatile("movl %%cr4, %0" : "=r"(cr4));
+		cr4 |= CR4_OSFXSR;
+		if (cpufeatures & CPUID_SSE) {
+			cr4 |= CR4_OSXMMEXCPT;
+		}
+		asm volatile("movl %0, %%cr4" : : "r"(cr4));
+	}
+	asm volatile("clts; fninit");
+	cpuself()->cpfpuowner = -1;
+}
+
+/*------------------------------------------------------------------------
+ *  fputrap  -  Give the FPU to the current process on its first FPU
+ *		instruction since it was switched in (called by Xfpu)
+ *------------------------------------------------------------------------
+ */
+void	fputrap(void)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+
+	asm volatile("clts");
+	cpptr = cpuself();
+	if (cpptr->cpfpuowner == currpid) {
+		return;			/* TS left by a task switch	*/
+	}
+	if (cpptr->cpfpuowner >= 0) {
+		fpusave(proctab[cpptr->cpfpuowner].prfpu);
+	}
+	cpptr->cpfpuowner = -1;
+	prptr = &proctab[currpid];
+	if (prptr->prfpu == NULL) {
+		prptr->prfpu = cache_alloc(fpucache);
+		if (prptr->prfpu == NULL) {
+			kprintf("no memory for the FPU state of %s\n",
+				prptr->prname);
+			kill(currpid);
+			return;
+		}
+		memcpy(prptr->prfpu, fpuclean, FPU_SAVESIZE);
+	}
+	fpurestore(prptr->prfpu);
+	cpptr->cpfpuowner = currpid;
+	fpuloads++;
+}
+
+/*------------------------------------------------------------------------
+ *  fpuswitch  -  Make FPU instructions trap unless the state of the
+ *		  process about to run is the one in the FPU; with more
+ *		  than one processor, the state of the owner is saved at
+ *		  once, as the owner may next run on another processor
+ *------------------------------------------------------------------------
+ */
+void	fpuswitch(
+	  pid32		pid		/* Process being switched in	*/
+	)
+{
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+	uint32	cr0;			/* Control register 0		*/
+
+	cpptr = cpuself();
+	asm volatile("movl %%cr0, %0" : "=r"(cr0));
+	if (pid == cpptr->cpfpuowner) {
+		if (cr0 & CR0_TS) {
+			asm volatile("clts");
+		}
+		return;
+	}
+	if (ncpuonline > 1 && cpptr->cpfpuowner >= 0) {
+		if (cr0 & CR0_TS) {
+			asm volatile("clts");
+			cr0 &= ~CR0_TS;
+		}
+		fpusave(proctab[cpptr->cpfpuowner].prfpu);
+		cpptr->cpfpuowner = -1;
+	}
+	if (!(cr0 & CR0_TS)) {
+		asm volatile("movl %0, %%cr0" : : "r"(cr0 | CR0_TS));
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  fpufork  -  Give a forked child a copy of the FPU state of the
+ *		current process, if it has any
+ *------------------------------------------------------------------------
+ */
+status	fpufork(
+	  pid32		pid		/* Child, a copy of currpid	*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to the child's entry	*/
+
+	prptr = &proctab[pid];
+	if (proctab[currpid].prfpu == NULL) {
+		prptr->prfpu = NULL;
+		return OK;
+	}
+	prptr->prfpu = cache_alloc(fpucache);
+	if (prptr->prfpu == NULL) {
+		return SYSERR;
+	}
+	if (cpuself()->cpfpuowner == currpid) {
+		asm volatile("clts");	/* The owner may use the FPU	*/
+		fpusave(proctab[currpid].prfpu);
+		if (!(cpufeatures & CPUID_FXSR)) {
+			fpurestore(proctab[currpid].prfpu);
+		}			/* fnsave reinitialized it	*/
+	}
+	memcpy(prptr->prfpu, proctab[currpid].prfpu, FPU_SAVESIZE);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  fpufree  -  Release the FPU state of a process that is going away
+ *------------------------------------------------------------------------
+ */
+void	fpufree(
+	  pid32		pid		/* Process being killed		*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	int32	i;
+
+	prptr = &proctab[pid];
+	for (i = 0; i < ncpus; i++) {	/* Nothing worth saving	*/
+		if (cputab[i].cpfpuowner == pid) {
+			cputab[i].cpfpuowner = -1;
+		}
+	}
+	if (prptr->prfpu != NULL) {
+		cache_free(fpucache, prptr->prfpu);
+		prptr->prfpu = NULL;
+	}
+}
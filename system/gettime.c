@@ -25,5 +25,10 @@ status	gettime(
 
 	*timvar = utim2ltim(now);
 #endif
+
+	/* Without a time server, count from the boot time (if known)	*/
+	/*   on the monotonic clock					*/
+
+	*timvar = Date.dt_boot + (uint32)udiv64(getnanos(), 1000000000, NULL);
 	return OK;
 }
@@ -24,7 +24,7 @@ struct	memblk	memlist;	/* List of free memory blocks		*/
 /* Active system status */
 
 int	prcount;		/* Total number of live processes	*/
-pid32	currpid;		/* ID of currently executing process	*/
+uint32	cpufeatures;		/* CPUID leaf 1 EDX feature flags	*/
 uint32 is_page;
 
 /* Control sequence to reset the console colors and cusor positiion	*/
@@ -54,17 +54,51 @@ static inline void lcr3(uint32 val)
 
 void InitializeVirtualMemory(void)
 {
-	struct page *static_pages = (struct page *)(KERNEL_END - PAGE_SIZE * 10);
+	struct page *static_pages = (struct page *)KERNEL_PGDIR;
 	memset(static_pages, 0, PAGE_SIZE);
 	int i, j;
-	for (i = 0; i <= 7; i++)
+	uint32 global = vm_pge ? PTE_G : 0; // kernel mappings are the same in every address space
+	uint32 cr4 = (vm_pse ? CR4_PSE : 0) | (vm_pge ? CR4_PGE : 0);
+	if (vm_pse)
+	{ // 4 MB pages: 0 - 32 MB and the direct map need no page tables
+		for (i = 0; i <= 7; i++)
+		{
+			static_pages[0].entries[i] = (i << 22) | PTE_P | PTE_W | PTE_PS | global;
+		}
+		for (i = 0; i < ndmpdes; i++)
+		{
+			static_pages[0].entries[DM_PDE + i] = (i << 22) | PTE_P | PTE_W | PTE_PS | global;
+		}
+	}
+	else
 	{
-		static_pages[0].entries[i] = (uint32)((char *)static_pages + ((i + 1) * PAGE_SIZE)) | PTE_P | PTE_W;
-		for (j = 0; j < 1024; j++)
+		for (i = 0; i <= 7; i++)
 		{
-			static_pages[i + 1].entries[j] = ((i << 10) + j) << 12 | PTE_P | PTE_W;
+			static_pages[0].entries[i] = (uint32)((char *)static_pages + ((i + 1) * PAGE_SIZE)) | PTE_P | PTE_W;
+			for (j = 0; j < 1024; j++)
+			{
+				static_pages[i + 1].entries[j] = ((i << 10) + j) << 12 | PTE_P | PTE_W | global;
+			}
+		}
+		for (i = 0; i < ndmpdes; i++)
+		{ // direct map of physical memory at DM_BASE
+			static_pages[0].entries[DM_PDE + i] = (uint32)&dmtabs[i] | PTE_P | PTE_W;
+			for (j = 0; j < 1024; j++)
+			{
+				dmtabs[i].entries[j] = ((i << 10) + j) << 12 | PTE_P | PTE_W | global;
+			}
 		}
 	}
+	if (cr4)
+	{
+		asm volatile(
+			"movl %%cr4, %%eax\n\t"
+			"orl %0, %%eax\n\t"
+			"movl %%eax, %%cr4\n\t"
+			:
+			: "r"(cr4)
+			: "eax");
+	}
 	static_pages[0].entries[1021] = (uint32)((char *)static_pages + (9 * PAGE_SIZE)) | PTE_P | PTE_W;
 	memset((char *)static_pages + 9 * PAGE_SIZE, 0, PAGE_SIZE);
 	static_pages[9].entries[1023] = 0x6000 | PTE_P | PTE_W;
@@ -75,10 +109,10 @@ void InitializeVirtualMemory(void)
 		"orl $0xff7ff000, %%esp\n\t"
 		"orl $0xff7ff000, %%ebp\n\t"
 		"movl %%cr0, %%eax\n\t"
-		"orl $0x80000000, %%eax\n\t"
+		"orl %0, %%eax\n\t"
 		"movl %%eax, %%cr0\n\t"
 		:
-		:
+		: "i"(CR0_PG | CR0_WP) /* WP: copy-on-write pages fault in the kernel too */
 		: "eax");
 }
 
@@ -86,6 +120,17 @@ void InitializeVirtualMemory(void)
 void nulluser()
 {
 	is_page = 0;
+	cpufeatures = cpufeat(); // find out what the processor supports
+#ifdef VM_PSE
+	vm_pse = (cpufeatures & CPUID_PSE) != 0;
+#else
+	vm_pse = 0;
+#endif
+#ifdef VM_PGE
+	vm_pge = (cpufeatures & CPUID_PGE) != 0;
+#else
+	vm_pge = 0;
+#endif
 	// kprintf("[I](nulluser) nulluser launched. Recording free pages...\n");
 	ScanFreePages(); // record free pages
 	// kprintf("[I](nulluser) free pages recorded. Initializing vm...\n");
@@ -106,9 +151,12 @@ void nulluser()
 	while (TRUE)
 	{
 
-		/* Halt until there is an external interrupt */
+		/* Stop the periodic tick until the next sleep deadline, and */
+		/*   halt until there is an external interrupt		     */
 
-		asm volatile("hlt");
+		disable();
+		clkstop();
+		idlewait();
 	}
 }
 
@@ -142,9 +190,10 @@ local process	startup(void)
  */
 static	void	sysinit()
 {
-	int32	i;
+	int32	i, j;
 	struct	procent	*prptr;		/* Ptr to process table entry	*/
 	struct	sentry	*semptr;	/* Ptr to semaphore table entry	*/
+	struct	cpuent	*cpptr;		/* Ptr to processor table entry	*/
 
 	/* Platform Specific Initialization */
 
@@ -184,15 +233,23 @@ static	void	sysinit()
 
 	prptr = &proctab[NULLPROC];
 	prptr->prstate = PR_CURR;
-	currpid = NULLPROC;
+	cputab[0].cpcurrpid = cputab[0].cpidlepid = NULLPROC;
 	prptr->prprio = 0;
 	strncpy(prptr->prname, "prnull", 7);
-	prptr->phypgdir = KERNEL_END - PAGE_SIZE * 10;
+	prptr->phypgdir = KERNEL_PGDIR;
 	prptr->prstkbase = allocstk(NULLSTK, prptr->phypgdir);
 	prptr->prstklen = NULLSTK;
 	prptr->prstkptr = (char *)prptr->prstkbase - prptr->prstklen;
-	prptr->freelistptr = NULL;
+	memset(prptr->freelists, 0, sizeof(prptr->freelists));
+	prptr->freemap = 0;
 	prptr->maxheap = KERNEL_END;
+	cpuclear(prptr);
+	prptr->prfpu = NULL;
+	prptr->prclass = PC_PRIO;
+	prptr->prbaseprio = prptr->prprio;
+	prptr->prmutex = prptr->prheld = -1;
+	prptr->prcpu = 0;
+	prptr->prreq = 0;
 	
 	/* Initialize semaphores */
 
@@ -203,18 +260,51 @@ static	void	sysinit()
 		semptr->squeue = newqueue();
 	}
 
-	/* Initialize buffer pools */
+	/* Initialize mutexes */
+
+	mutexinit();
+
+	/* Initialize buffer pools and object caches */
 
 	bufinit();
+	cacheinit();
 
-	/* Create a ready list for processes */
+	/* Switch the FPU and SSE state lazily between processes */
 
-	readylist = newqueue();
+	fpuinit();
+
+	/* Create the ready queues of each processor, one after another	*/
+	/*   in queuetab					*/
+
+	for (i = 0; i < NCPU; i++) {
+		cpptr = &cputab[i];
+		cpptr->cpindex = i;
+		cpptr->cpreadylist = newqueue();
+		for (j = 1; j < NRQBAND; j++) {
+			newqueue();
+		}
+		cpptr->cpreadymap = 0;
+		cpptr->cppreempt = QUANTUM;
+		cpptr->cpfpuowner = -1;
+		cpptr->cpreap = 0;
+	}
 
 	/* Initialize the real time clock */
 
 	clkinit();
 
+	/* Find the other processors and start them */
+
+	smpinit();
+
+	/* Take interrupts through the APICs when there are any */
+
+	apicinit();
+
+	/* Start the other processors, each running its idle process	*/
+
+	smpboot();
+
 	for (i = 0; i < NDEVS; i++) {
 		init(i);
 	}
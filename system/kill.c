@@ -16,17 +16,28 @@ extern void deallocstk(uint32);
 	intmask	mask;			/* Saved interrupt mask		*/
 	struct	procent *prptr;		/* Ptr to process's table entry	*/
 	int32	i;			/* Index into descriptors	*/
+	bool8	woke;			/* Passing on its mutexes made	*/
+					/*   a process ready		*/
 
 	mask = disable();
 #ifdef DEBUG_INFO
 	kprintf("[I](kill) kill called for process(pid: %d, prname: %s)\n", pid, proctab[pid].prname);
 #endif
-	if (isbadpid(pid) || (pid == NULLPROC)
+	if (isbadpid(pid) || isidlepid(pid)
 	    || ((prptr = &proctab[pid])->prstate) == PR_FREE) {
 		restore(mask);
 		return SYSERR;
 	}
 
+	/* A process running on another processor is killed there	*/
+
+	if (prptr->prstate == PR_CURR && pid != currpid) {
+		prptr->prreq |= PRQ_KILL;
+		cpuipi(prptr->prcpu, IPI_REQUEST);
+		restore(mask);
+		return OK;
+	}
+
 	if (--prcount <= 1) {		/* Last user process completes	*/
 		xdone();
 	}
@@ -36,7 +47,12 @@ extern void deallocstk(uint32);
 		close(prptr->prdesc[i]);
 	}
 	// freestk(prptr->prstkbase, prptr->prstklen);
-	deallocstk(prptr->phypgdir);
+	if (prptr->prstate != PR_CURR) {
+		deallocstk(prptr->phypgdir);	/* Else resched frees it*/
+	}					/*   once off its stack	*/
+	fpufree(pid);
+	edffree(pid);
+	woke = mutexkill(pid);
 
 	switch (prptr->prstate) {
 	case PR_CURR:
@@ -51,16 +67,22 @@ extern void deallocstk(uint32);
 
 	case PR_WAIT:
 		semtab[prptr->prsem].scount++;
-		/* Fall through */
+		getitem(pid);		/* Remove from semaphore queue */
+		prptr->prstate = PR_FREE;
+		break;
 
 	case PR_READY:
-		getitem(pid);		/* Remove from queue */
-		/* Fall through */
+		readyremove(pid);	/* Remove from ready queue */
+		prptr->prstate = PR_FREE;
+		break;
 
 	default:
 		prptr->prstate = PR_FREE;
 	}
 
+	if (woke) {
+		resched();
+	}
 	restore(mask);
 	return OK;
 }
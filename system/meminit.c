@@ -30,7 +30,7 @@ struct __attribute__ ((__packed__)) sd {
 	unsigned char	sd_hibase;
 };
 
-#define	NGD			4	/* Number of global descriptor entries	*/
+#define	NGD			7	/* Number of global descriptor entries	*/
 #define FLAGS_GRANULARITY	0x80
 #define FLAGS_SIZE		0x40
 #define	FLAGS_SETTINGS		(FLAGS_GRANULARITY | FLAGS_SIZE)
@@ -47,14 +47,68 @@ struct sd gdt_copy[NGD] = {
 {       0xffff,          0,           0,      0x92,         0xcf,        0, },
 /* 3rd, Kernel Stack Segment */
 {       0xffff,          0,           0,      0x92,         0xcf,        0, },
+/* 4th, TSS of the kernel task (base and limit set in setsegs) */
+{            0,          0,           0,      0x89,            0,        0, },
+/* 5th, TSS of the page fault task */
+{            0,          0,           0,      0x89,            0,        0, },
+/* 6th, Per-CPU segment: the processor's cputab entry (set in setsegs) */
+{            0,          0,           0,      0x92,         0x40,        0, },
 };
 
+struct	sd	cpugdt[NCPU][NGD];	/* Global segment tables of the	*/
+					/*   application processors	*/
+
 extern	struct	sd gdt[];	/* Global segment table			*/
 
-uint32 free_pages = 0;
-uint32 *ptpt = (uint32 *)(KERNEL_END - 10 * PAGE_SIZE);
-uint32 total_pages = 0;
-uint32 phypagemax;
+/* Physical frame allocator state (see GetOnePage / FreeOnePage) */
+
+uint32	free_pages = 0;		/* Frames currently on the free lists	*/
+uint32	total_pages = 0;	/* Frames managed by the allocator	*/
+uint32	*ptpt = (uint32 *)(KERNEL_END - 10 * PAGE_SIZE);
+				/* Top of the frame table, just below	*/
+				/*   the static page directory		*/
+struct	frentry	*frtab;		/* One entry per managed frame		*/
+struct	frregion frregions[NFRREGION];	/* Usable physical regions	*/
+uint32	nfrregions = 0;		/* Number of entries in frregions	*/
+struct	page	*dmtabs;	/* Page tables of the direct map	*/
+uint32	ndmpdes;		/* Number of direct map page tables	*/
+
+/*------------------------------------------------------------------------
+ * AddFrameRegion - record the whole pages of a usable memory block as
+ *			a region of frames for the frame allocator
+ *------------------------------------------------------------------------
+ */
+static void AddFrameRegion(uint32 base, uint32 length)
+{
+	struct frregion *frptr;
+	uint32 first = (base + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	uint32 last = (base + length) & ~(PAGE_SIZE - 1);
+
+	/* Frames must be reachable through the direct map */
+	if (base >= DM_MAX)
+	{
+		return;
+	}
+	if (length > DM_MAX - base)
+	{
+		last = DM_MAX;
+	}
+
+	if (last <= first)
+	{
+		return;
+	}
+	if (nfrregions >= NFRREGION)
+	{
+		kprintf("[W](ScanFreePages) too many memory regions, ignoring 0x%x - 0x%x\n", first, last);
+		return;
+	}
+	frptr = &frregions[nfrregions++];
+	frptr->fr_base = first;
+	frptr->fr_npages = (last - first) / PAGE_SIZE;
+	frptr->fr_index = total_pages;
+	total_pages += frptr->fr_npages;
+}
 
 void ScanFreePages(void)
 {
@@ -64,8 +118,9 @@ void ScanFreePages(void)
 	struct mbmregion *mmap_addrend; /* Ptr to end of mmap region	*/
 	struct memblk *next_memptr;		/* Ptr to next memory block	*/
 	uint32 next_block_length;		/* Size of next memory block	*/
-
-	uint32 tmp_ptr;
+	struct frregion *frptr;			/* Ptr to frame region		*/
+	uint32 pfn, order;				/* Frame number and block order	*/
+	int32 i, j;
 
 	mmap_addr = (struct mbmregion *)NULL;
 	mmap_addrend = (struct mbmregion *)NULL;
@@ -101,8 +156,9 @@ void ScanFreePages(void)
 	while (mmap_addr < mmap_addrend)
 	{
 
-		/* If block is not usable, skip to next block */
-		if (mmap_addr->type != MULTIBOOT_MMAP_TYPE_USABLE)
+		/* If block is not usable or lies above 4 GB, skip to next block */
+		if (mmap_addr->type != MULTIBOOT_MMAP_TYPE_USABLE ||
+			mmap_addr->base_addr >= 0x100000000ULL)
 		{
 			mmap_addr = (struct mbmregion *)((uint8 *)mmap_addr + mmap_addr->size + 4);
 			continue;
@@ -133,15 +189,6 @@ void ScanFreePages(void)
 
 			/* Subtract Xinu image from length of block */
 			next_block_length = (uint32)truncmb(mmap_addr->base_addr + mmap_addr->length - (uint32)minheap);
-
-			tmp_ptr = (uint32)next_memptr;
-			int i;
-			for (i = 0; i < next_block_length / 4096; i++)
-			{
-				free_pages++;
-				*(ptpt - free_pages) = tmp_ptr;
-				tmp_ptr += 4096;
-			}
 		}
 		else
 		{
@@ -151,17 +198,11 @@ void ScanFreePages(void)
 
 			/* Initialize the length of the block */
 			next_block_length = (uint32)truncmb(mmap_addr->length);
-
-			tmp_ptr = (uint32)next_memptr;
-			int i;
-			for (i = 0; i < next_block_length / 4096; i++)
-			{
-				free_pages++;
-				*(ptpt - free_pages) = tmp_ptr;
-				tmp_ptr += 4096;
-			}
 		}
 
+		/* Hand the whole pages of the block to the frame allocator */
+		AddFrameRegion((uint32)next_memptr, next_block_length);
+
 		/* Add then new block to the free list */
 		memptr->mnext = next_memptr;
 		memptr = memptr->mnext;
@@ -178,17 +219,53 @@ void ScanFreePages(void)
 		memptr->mnext = (struct memblk *)NULL;
 	}
 
+	/* Place the frame table below ptpt, every frame starts used,	*/
+	/*   and the direct map page tables (unless 4 MB pages are	*/
+	/*   used) below the frame table				*/
+	frtab = (struct frentry *)ptpt - total_pages;
+	if ((uint32)maxheap > DM_MAX)
+	{
+		maxheap = (void *)DM_MAX;
+	}
+	ndmpdes = ((uint32)maxheap + (1 << 22) - 1) >> 22;
+	dmtabs = (struct page *)((uint32)frtab & ~(PAGE_SIZE - 1)) - (vm_pse ? 0 : ndmpdes);
+	if ((uint32)dmtabs < (uint32)&end)
+	{
+		panic("frame table overlaps the Xinu image");
+	}
+	memset(frtab, 0, total_pages * sizeof(struct frentry));
+	for (i = 0; i <= FR_MAXORDER; i++)
+	{
+		frfree[i] = EMPTY;
+		frnfree[i] = 0;
+	}
+
+	/* Free each region into the buddy pool as maximal aligned blocks */
+	free_pages = 0;
+	for (i = 0; i < nfrregions; i++)
+	{
+		frptr = &frregions[i];
+		pfn = frptr->fr_base / PAGE_SIZE;
+		for (j = 0; j < frptr->fr_npages; j += 1 << order)
+		{
+			order = FR_MAXORDER;
+			while (((pfn + j) & ((1 << order) - 1)) ||
+				   j + (1 << order) > frptr->fr_npages)
+			{
+				order--;
+			}
+			FreePages((struct page *)(frptr->fr_base + j * PAGE_SIZE), order);
+		}
+	}
+
 #ifdef DEBUG_INFO
 	kprintf("[I](ScanFreePages) minheap is set to 0x%x\n", (uint32)minheap);
-	kprintf("[I](ScanFreePages) we have %d free pages\n", (uint32)free_pages);
-	int i;
-	for (i = 0; i < free_pages; i++)
+	kprintf("[I](ScanFreePages) we have %d free pages in %d region(s)\n", free_pages, nfrregions);
+	for (i = 0; i < nfrregions; i++)
 	{
-		kprintf("[I](ScanFreePages) free page #%d, physical address: 0x%x\n", i, *(ptpt - i - 1));
+		kprintf("[I](ScanFreePages) region #%d: 0x%x, %d pages\n", i, frregions[i].fr_base, frregions[i].fr_npages);
 	}
 #endif
-	total_pages = free_pages;
-	phypagemax = *(ptpt - free_pages);
 }
 
 /*------------------------------------------------------------------------
@@ -288,6 +365,36 @@ void	meminit_ori(void) {
 }
 
 
+/*------------------------------------------------------------------------
+ * setssd  -  Point a TSS descriptor at a task state segment
+ *------------------------------------------------------------------------
+ */
+local	void	setssd(
+	  struct sd	*psd,		/* Descriptor to fill in	*/
+	  struct tss	*ptss		/* Task state segment		*/
+	)
+{
+	psd->sd_lolimit = sizeof(struct tss) - 1;
+	psd->sd_lobase = (uint32)ptss & 0xffff;
+	psd->sd_midbase = ((uint32)ptss >> 16) & 0xff;
+	psd->sd_hibase = ((uint32)ptss >> 24) & 0xff;
+}
+
+/*------------------------------------------------------------------------
+ * setcpusd  -  Point the per-CPU descriptor at the entry of a processor
+ *------------------------------------------------------------------------
+ */
+local	void	setcpusd(
+	  struct sd	*psd,		/* Descriptor to fill in	*/
+	  struct cpuent	*cpptr		/* Entry of the processor	*/
+	)
+{
+	psd->sd_lolimit = sizeof(struct cpuent) - 1;
+	psd->sd_lobase = (uint32)cpptr & 0xffff;
+	psd->sd_midbase = ((uint32)cpptr >> 16) & 0xff;
+	psd->sd_hibase = ((uint32)cpptr >> 24) & 0xff;
+}
+
 /*------------------------------------------------------------------------
  * setsegs  -  Initialize the global segment table
  *------------------------------------------------------------------------
@@ -314,5 +421,36 @@ void	setsegs()
 	psd->sd_lolimit = ds_end;
 	psd->sd_hilim_fl = FLAGS_SETTINGS | ((ds_end >> 16) & 0xff);
 
+	setssd(&gdt_copy[TSS_MAIN / 8], &cputab[0].cptssmain);
+	setssd(&gdt_copy[TSS_PF / 8], &cputab[0].cptsspf);
+	setcpusd(&gdt_copy[KSEG_CPU / 8], &cputab[0]);
+
 	memcpy(gdt, gdt_copy, sizeof(gdt_copy));
 }
+
+/*------------------------------------------------------------------------
+ * setcpusegs  -  Load a global segment table of its own on an
+ *		  application processor, so that the task state and
+ *		  per-CPU selectors lead to its own cputab entry
+ *------------------------------------------------------------------------
+ */
+void	setcpusegs(
+	  int32		cpu		/* Index of the processor	*/
+	)
+{
+	struct	sd	*cgdt;		/* Its segment table		*/
+	struct	__attribute__ ((__packed__)) {
+		uint16	limit;
+		uint32	base;
+	} gdtr;				/* Operand of lgdt		*/
+
+	cgdt = cpugdt[cpu];
+	memcpy(cgdt, gdt_copy, sizeof(gdt_copy));
+	setssd(&cgdt[TSS_MAIN / 8], &cputab[cpu].cptssmain);
+	setssd(&cgdt[TSS_PF / 8], &cputab[cpu].cptsspf);
+	setcpusd(&cgdt[KSEG_CPU / 8], &cputab[cpu]);
+	gdtr.limit = sizeof(gdt_copy) - 1;
+	gdtr.base = (uint32)cgdt;
+	asm volatile("lgdt %0" : : "m"(gdtr));
+	asm volatile("movw %w0, %%fs" : : "r"(KSEG_CPU) : "memory");
+}
@@ -0,0 +1,307 @@
+/* mutex.c - mutexinit, mutex_create, mutex_delete, mutex_lock,		*/
+/*		mutex_unlock, mutexprio, mutexkill			*/
+
+#include <xinu.h>
+
+struct	mutent	mutab[NMUTEX];	/* Mutex table				*/
+
+/*------------------------------------------------------------------------
+ *  mxsetprio  -  Change the priority of a process, keeping the queue it
+ *		  is on in order
+ *------------------------------------------------------------------------
+ */
+local	void	mxsetprio(		/* Assumes interrupts disabled	*/
+	  pid32		pid,		/* ID of the process		*/
+	  pri16		prio		/* Its new priority		*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+
+	prptr = &proctab[pid];
+	switch (prptr->prstate) {
+	case PR_READY:
+		readyremove(pid);
+		prptr->prprio = prio;
+		readyinsert(pid, prio);
+		break;
+
+	case PR_MUTEX:
+		getitem(pid);
+		prptr->prprio = prio;
+		insert(pid, mutab[prptr->prmutex].mxqueue, prio);
+		break;
+
+	default:
+		prptr->prprio = prio;
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  mxupdate  -  Recompute the priority of a process from its base
+ *		 priority and the waiters on the mutexes it holds, and
+ *		 pass a change on to the owners it waits behind
+ *------------------------------------------------------------------------
+ */
+local	void	mxupdate(		/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of the process		*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	mxid32	mx;			/* Walks the mutexes it holds	*/
+	qid16	q;			/* Queue of a mutex		*/
+	pri16	prio;			/* Priority it should run at	*/
+
+	while (pid >= 0) {
+		prptr = &proctab[pid];
+		prio = prptr->prbaseprio;
+		for (mx = prptr->prheld; mx >= 0; mx = mutab[mx].mxnext) {
+			q = mutab[mx].mxqueue;
+			if (nonempty(q) && firstkey(q) > prio) {
+				prio = firstkey(q);
+			}
+		}
+		if (prio == prptr->prprio) {
+			return;
+		}
+		mxsetprio(pid, prio);
+		if (prptr->prstate != PR_MUTEX) {
+			return;
+		}
+		pid = mutab[prptr->prmutex].mxowner;
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  mxpass  -  Take a mutex from its owner and give it to the highest
+ *	       priority waiter, if any; return the new owner or -1
+ *------------------------------------------------------------------------
+ */
+local	pid32	mxpass(			/* Assumes interrupts disabled	*/
+	  mxid32	mx		/* ID of a held mutex		*/
+	)
+{
+	struct	mutent	*mxptr;		/* Ptr to mutex table entry	*/
+	mxid32	*link;			/* Walks the owner's held list	*/
+	pid32	pid;			/* Next owner			*/
+
+	mxptr = &mutab[mx];
+	link = &proctab[mxptr->mxowner].prheld;
+	while (*link != mx) {
+		link = &mutab[*link].mxnext;
+	}
+	*link = mxptr->mxnext;
+	mxptr->mxowner = -1;
+	mxptr->mxnext = -1;
+	if (isempty(mxptr->mxqueue)) {
+		return -1;
+	}
+
+	/* The first waiter has the highest priority of them all, so	*/
+	/*   it has no priority to inherit from the others		*/
+
+	pid = dequeue(mxptr->mxqueue);
+	proctab[pid].prmutex = -1;
+	mxptr->mxowner = pid;
+	mxptr->mxnext = proctab[pid].prheld;
+	proctab[pid].prheld = mx;
+	return pid;
+}
+
+/*------------------------------------------------------------------------
+ *  mutexinit  -  Initialize the mutex table
+ *------------------------------------------------------------------------
+ */
+void	mutexinit(void)
+{
+	struct	mutent	*mxptr;		/* Ptr to mutex table entry	*/
+	int32	i;
+
+	for (i = 0; i < NMUTEX; i++) {
+		mxptr = &mutab[i];
+		mxptr->mxstate = MX_FREE;
+		mxptr->mxowner = -1;
+		mxptr->mxnext = -1;
+		mxptr->mxqueue = newqueue();
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  mutex_create  -  Create an unlocked mutex and return its ID
+ *------------------------------------------------------------------------
+ */
+mxid32	mutex_create(
+	  char		*name		/* Name (for debugging)		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	mutent	*mxptr;		/* Ptr to mutex table entry	*/
+	mxid32	mx;			/* Mutex ID to return		*/
+	int32	i;
+
+	mask = disable();
+	for (mx = 0; mx < NMUTEX; mx++) {
+		if (mutab[mx].mxstate == MX_FREE) {
+			break;
+		}
+	}
+	if (mx >= NMUTEX) {
+		restore(mask);
+		return SYSERR;
+	}
+	mxptr = &mutab[mx];
+	mxptr->mxstate = MX_USED;
+	mxptr->mxowner = -1;
+	mxptr->mxnext = -1;
+	for (i = 0; i < MXNMLEN - 1 && name[i] != NULLCH; i++) {
+		mxptr->mxname[i] = name[i];
+	}
+	mxptr->mxname[i] = NULLCH;
+	mxptr->mxlocks = mxptr->mxwaits = 0;
+	mxptr->mxmaxwait = 0;
+	restore(mask);
+	return mx;
+}
+
+/*------------------------------------------------------------------------
+ *  mutex_delete  -  Free a mutex that no process holds
+ *------------------------------------------------------------------------
+ */
+syscall	mutex_delete(
+	  mxid32	mx		/* ID of mutex to free		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+
+	mask = disable();
+	if (isbadmutex(mx) || mutab[mx].mxstate == MX_FREE
+	    || mutab[mx].mxowner >= 0) {
+		restore(mask);
+		return SYSERR;
+	}
+	mutab[mx].mxstate = MX_FREE;
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  mutex_lock  -  Lock a mutex, waiting while another process holds it;
+ *		   the holder inherits the priority of the caller
+ *------------------------------------------------------------------------
+ */
+syscall	mutex_lock(
+	  mxid32	mx		/* ID of mutex to lock		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	mutent	*mxptr;		/* Ptr to mutex table entry	*/
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	uint64	waited;			/* Time the caller was blocked	*/
+
+	mask = disable();
+	if (isbadmutex(mx) || (mxptr = &mutab[mx])->mxstate == MX_FREE
+	    || mxptr->mxowner == currpid) {
+		restore(mask);
+		return SYSERR;
+	}
+	mxptr->mxlocks++;
+	prptr = &proctab[currpid];
+
+	if (mxptr->mxowner < 0) {	/* Uncontended: just take it	*/
+		mxptr->mxowner = currpid;
+		mxptr->mxnext = prptr->prheld;
+		prptr->prheld = mx;
+		restore(mask);
+		return OK;
+	}
+
+	mxptr->mxwaits++;
+	prptr->prstate = PR_MUTEX;
+	prptr->prmutex = mx;
+	prptr->prblockat = cpustamp();
+	insert(currpid, mxptr->mxqueue, prptr->prprio);
+	mxupdate(mxptr->mxowner);
+	resched();
+
+	/* mutex_unlock made the caller the owner before readying it	*/
+
+	waited = cpustamp() - prptr->prblockat;
+	if (waited > mxptr->mxmaxwait) {
+		mxptr->mxmaxwait = waited;
+	}
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  mutex_unlock  -  Unlock a mutex the caller holds, handing it to the
+ *		     highest priority waiter, and give up any priority
+ *		     inherited through it
+ *------------------------------------------------------------------------
+ */
+syscall	mutex_unlock(
+	  mxid32	mx		/* ID of mutex to unlock	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	pid32	pid;			/* Process that gets the mutex	*/
+
+	mask = disable();
+	if (isbadmutex(mx) || mutab[mx].mxstate == MX_FREE
+	    || mutab[mx].mxowner != currpid) {
+		restore(mask);
+		return SYSERR;
+	}
+	pid = mxpass(mx);
+	mxupdate(currpid);
+	if (pid >= 0) {
+		ready(pid);
+	}
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  mutexprio  -  Set the priority of a process after its base priority
+ *		  changed
+ *------------------------------------------------------------------------
+ */
+void	mutexprio(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of the process		*/
+	)
+{
+	mxupdate(pid);
+}
+
+/*------------------------------------------------------------------------
+ *  mutexkill  -  Take a process being killed off the mutex it waits on
+ *		  and pass on the mutexes it holds; return TRUE when that
+ *		  made a process ready
+ *------------------------------------------------------------------------
+ */
+bool8	mutexkill(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of the process		*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	mxid32	mx;			/* Mutex it waits on or holds	*/
+	pid32	next;			/* Process that gets a mutex	*/
+	bool8	woke;			/* A process was made ready	*/
+
+	prptr = &proctab[pid];
+	if (prptr->prstate == PR_MUTEX) {
+		mx = prptr->prmutex;
+		getitem(pid);
+		prptr->prmutex = -1;
+		mxupdate(mutab[mx].mxowner);
+	}
+	woke = FALSE;
+	while ((mx = prptr->prheld) >= 0) {
+		next = mxpass(mx);
+		if (next >= 0) {
+			proctab[next].prstate = PR_READY;
+			readyplace(next);
+			woke = TRUE;
+		}
+	}
+	return woke;
+}
@@ -15,6 +15,7 @@ void	_ptclear(
 	 )
 {
 	struct	ptnode	*walk;		/* Pointer to walk message list	*/
+	struct	ptnode	*next;		/* Node after walk		*/
 
 	/* Place port in limbo state while waiting processes are freed */
 
@@ -25,16 +26,14 @@ void	_ptclear(
 
 	if ( walk != NULL ) {		/* If message list nonempty	*/
 
-		/* Walk message list and dispose of each message */
+		/* Walk message list, dispose of each message and	*/
+		/*   return its node to the cache			*/
 
-		for( ; walk!=NULL ; walk=walk->ptnext) {
+		for( ; walk!=NULL ; walk=next) {
+			next = walk->ptnext;
                         (*dispose)( walk->ptmsg );
+			cache_free(ptcache, walk);
 		}
-
-		/* Link entire message list into the free list */
-
-                (ptptr->pttail)->ptnext = ptfree;
-                ptfree = ptptr->pthead;
         }
 
 	if (newstate == PT_ALLOC) {
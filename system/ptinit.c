@@ -2,7 +2,8 @@
 
 #include <xinu.h>
 
-struct	ptnode	*ptfree;		/* List of free message nodes	*/
+cid32	ptcache;			/* Cache of message nodes	*/
+int32	ptmaxmsgs;			/* Total messages in all ports	*/
 struct	ptentry	porttab[NPORTS];	/* Port table			*/
 int32	ptnextid;			/* Next table entry to try	*/
 
@@ -15,14 +16,14 @@ syscall	ptinit(
 	)
 {
 	int32	i;			/* Runs through the port table	*/
-	struct	ptnode	*next, *curr;	/* Used to build a free list	*/
 
-	/* Allocate memory for all messages on all ports */
+	/* Message nodes come from an object cache as they are needed	*/
 
-	ptfree = (struct ptnode *)getmem(maxmsgs*sizeof(struct ptnode));
-	if (ptfree == (struct ptnode *)SYSERR) {
-		panic("ptinit - insufficient memory");
+	ptcache = cache_create(sizeof(struct ptnode), 0);
+	if (ptcache == SYSERR) {
+		panic("ptinit - no object cache for message nodes");
 	}
+	ptmaxmsgs = maxmsgs;
 
 	/* Initialize all port table entries to free */
 
@@ -31,15 +32,5 @@ syscall	ptinit(
 		porttab[i].ptseq = 0;
 	}
 	ptnextid = 0;
-
-	/* Create a free list of message nodes linked together */
-
-	for ( curr=next=ptfree ;  --maxmsgs > 0  ; curr=next ) {
-		curr->ptnext = ++next;
-	}
-
-	/* Set the pointer in the final node to NULL */
-
-	curr->ptnext = NULL;
 	return OK;
 }
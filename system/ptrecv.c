@@ -40,8 +40,7 @@ uint32	ptrecv(
 		ptptr->pthead = ptptr->pttail = NULL;
 	else
 		ptptr->pthead = msgnode->ptnext;
-	msgnode->ptnext = ptfree;		/* Return to free list	*/
-	ptfree = msgnode;
+	cache_free(ptcache, msgnode);		/* Return to the cache	*/
 	signal(ptptr->ptssem);
 	restore(mask);
 	return msg;
@@ -33,14 +33,12 @@ syscall	ptsend(
 		restore(mask);
 		return SYSERR;
 	}
-	if (ptfree == NULL) {
+	/* Obtain node from the message node cache */
+
+	if (cachetab[ptcache].cainuse >= ptmaxmsgs
+	    || (msgnode = (struct ptnode *)cache_alloc(ptcache)) == NULL) {
 		panic("Port system ran out of message nodes");
 	}
-
-	/* Obtain node from free list by unlinking */
-
-	msgnode = ptfree;		/* Point to first free node	*/
-	ptfree  = msgnode->ptnext;	/* Unlink from the free list	*/
 	msgnode->ptnext = NULL;		/* Set fields in the node	*/
 	msgnode->ptmsg  = msg;
 
@@ -1,8 +1,22 @@
-/* ready.c - ready */
+/* ready.c - ready, readyinsert, readyget, readyremove, readyfirst,	*/
+/*		readybefore, readyplace, readysteal			*/
 
 #include <xinu.h>
 
-qid16	readylist;			/* Index of ready list		*/
+/*------------------------------------------------------------------------
+ *  readyband  -  Ready queue for a priority: one per priority below 16,
+ *		  then one per power of two
+ *------------------------------------------------------------------------
+ */
+local	int32	readyband(
+	  int32		prio		/* Priority of a process	*/
+	)
+{
+	if (prio < 16) {
+		return prio < 0 ? 0 : prio;
+	}
+	return 12 + HighBit(prio);	/* 16..26 for 16 <= prio < 2^15	*/
+}
 
 /*------------------------------------------------------------------------
  *  ready  -  Make a process eligible for CPU service
@@ -22,8 +36,239 @@ status	ready(
 
 	prptr = &proctab[pid];
 	prptr->prstate = PR_READY;
-	insert(pid, readylist, prptr->prprio);
+	readyplace(pid);
 	resched();
 
 	return OK;
 }
+
+/*------------------------------------------------------------------------
+ *  readyinsert  -  Put a process on the ready queue of its priority, on
+ *		    the processor it last ran on (prcpu), after processes
+ *		    of the same priority; EDF processes go on the highest
+ *		    queue by deadline instead
+ *------------------------------------------------------------------------
+ */
+void	readyinsert(			/* Assumes interrupts disabled	*/
+	  pid32		pid,		/* ID of process to insert	*/
+	  int32		prio		/* Priority of the process	*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	struct	cpuent	*cpptr;		/* Processor it waits for	*/
+	int32	band;			/* Ready queue to use		*/
+	qid16	curr;			/* Node after the new process	*/
+	qid16	prev;			/* Node before the new process	*/
+
+	prptr = &proctab[pid];
+	cpptr = &cputab[prptr->prcpu];
+	if (prptr->prclass == PC_EDF) {
+
+		/* Walk back over later deadlines; the key is the	*/
+		/*   deadline, compared so that the tick count may wrap	*/
+
+		band = EDFBAND;
+		prio = prptr->prdeadline;
+		curr = queuetail(readyq(cpptr, band));
+		prev = queuetab[curr].qprev;
+		while (prev != queuehead(readyq(cpptr, band))
+		       && (int32)(queuetab[prev].qkey - prio) > 0) {
+			curr = prev;
+			prev = queuetab[prev].qprev;
+		}
+	} else {
+		band = readyband(prio);
+
+		/* Walk back from the tail over lower priorities only;	*/
+		/*   when a queue holds a single priority this takes no	*/
+		/*   steps						*/
+
+		curr = queuetail(readyq(cpptr, band));
+		prev = queuetab[curr].qprev;
+		while (queuetab[prev].qkey < prio) {
+			curr = prev;
+			prev = queuetab[prev].qprev;
+		}
+	}
+	queuetab[pid].qnext = curr;
+	queuetab[pid].qprev = prev;
+	queuetab[pid].qkey = prio;
+	queuetab[prev].qnext = pid;
+	queuetab[curr].qprev = pid;
+	cpptr->cpreadymap |= 1 << band;
+	prptr->prreadyat = cpustamp();
+}
+
+/*------------------------------------------------------------------------
+ *  readyget  -  Remove and return the highest priority process ready on
+ *		 this processor
+ *------------------------------------------------------------------------
+ */
+pid32	readyget(void)			/* Assumes interrupts disabled	*/
+{
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+	int32	band;			/* Highest nonempty ready queue	*/
+	pid32	pid;			/* Process to return		*/
+
+	cpptr = cpuself();
+	if (cpptr->cpreadymap == 0) {
+		return EMPTY;
+	}
+	band = HighBit(cpptr->cpreadymap);
+	pid = getfirst(readyq(cpptr, band));
+	if (isempty(readyq(cpptr, band))) {
+		cpptr->cpreadymap &= ~(1 << band);
+	}
+	return pid;
+}
+
+/*------------------------------------------------------------------------
+ *  readyremove  -  Take a ready process off its ready queue
+ *------------------------------------------------------------------------
+ */
+void	readyremove(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of a ready process	*/
+	)
+{
+	struct	cpuent	*cpptr;		/* Processor it waits for	*/
+	int32	band;			/* Ready queue holding pid	*/
+
+	cpptr = &cputab[proctab[pid].prcpu];
+	band = proctab[pid].prclass == PC_EDF ? EDFBAND
+			: readyband(queuetab[pid].qkey);
+	getitem(pid);
+	if (isempty(readyq(cpptr, band))) {
+		cpptr->cpreadymap &= ~(1 << band);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  readyfirst  -  Tell whether a running process goes before every one
+ *		   ready on this processor: EDF processes by deadline,
+ *		   then priorities
+ *------------------------------------------------------------------------
+ */
+bool8	readyfirst(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of the running process	*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+
+	prptr = &proctab[pid];
+	cpptr = cpuself();
+	if (cpptr->cpreadymap & (1 << EDFBAND)) {
+		return prptr->prclass == PC_EDF
+			&& (int32)(prptr->prdeadline
+				- firstkey(readyq(cpptr, EDFBAND))) <= 0;
+	}
+	return prptr->prclass == PC_EDF || prptr->prprio > readykey(cpptr);
+}
+
+/*------------------------------------------------------------------------
+ *  readybefore  -  Tell whether process a should run before process b:
+ *		    EDF processes by deadline, then priorities
+ *------------------------------------------------------------------------
+ */
+bool8	readybefore(			/* Assumes interrupts disabled	*/
+	  pid32		a,		/* ID of one process		*/
+	  pid32		b		/* ID of the other		*/
+	)
+{
+	struct	procent	*aptr, *bptr;	/* Ptrs to their table entries	*/
+
+	aptr = &proctab[a];
+	bptr = &proctab[b];
+	if (aptr->prclass == PC_EDF) {
+		return bptr->prclass != PC_EDF
+			|| (int32)(aptr->prdeadline - bptr->prdeadline) < 0;
+	}
+	return bptr->prclass != PC_EDF && aptr->prprio > bptr->prprio;
+}
+
+/*------------------------------------------------------------------------
+ *  readyplace  -  Make a process ready on a processor: the one it last
+ *		   ran on if that is idle, else any idle one, else the
+ *		   one running the least urgent process if it goes before
+ *		   that; another processor that should switch to it gets
+ *		   an IPI
+ *------------------------------------------------------------------------
+ */
+void	readyplace(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of a process now PR_READY	*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	struct	cpuent	*cpptr;		/* Walks through the processors	*/
+	struct	cpuent	*target;	/* Processor chosen		*/
+	struct	cpuent	*worst;		/* Runs the least urgent process*/
+	int32	i;
+
+	prptr = &proctab[pid];
+	target = &cputab[prptr->prcpu];
+	if (ncpuonline > 1 && !cpuidle(target)) {
+		worst = target;
+		for (i = 0; i < ncpus; i++) {
+			cpptr = &cputab[i];
+			if (cpptr->cpstate != CPU_ONLINE) {
+				continue;
+			}
+			if (cpuidle(cpptr)) {
+				worst = cpptr;
+				break;
+			}
+			if (readybefore(worst->cpcurrpid, cpptr->cpcurrpid)) {
+				worst = cpptr;
+			}
+		}
+		if (cpuidle(worst) || readybefore(pid, worst->cpcurrpid)) {
+			target = worst;
+		}
+	}
+	prptr->prcpu = target->cpindex;
+	readyinsert(pid, prptr->prprio);
+	if (target != cpuself() && readybefore(pid, target->cpcurrpid)) {
+		cpuipi(target->cpindex, IPI_RESCHED);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  readysteal  -  Move the most urgent process ready on another
+ *		   processor to this one, which has nothing else to run
+ *------------------------------------------------------------------------
+ */
+void	readysteal(void)		/* Assumes interrupts disabled	*/
+{
+	struct	cpuent	*self;		/* Entry of this processor	*/
+	struct	cpuent	*cpptr;		/* Walks through the processors	*/
+	struct	cpuent	*victim;	/* Processor to take from	*/
+	int32	band, best;		/* Highest band there, and best	*/
+	int32	i;
+	pid32	pid;			/* Process moved		*/
+	uint64	readyat;		/* It keeps its waiting time	*/
+
+	self = cpuself();
+	victim = NULL;
+	best = 0;
+	for (i = 0; i < ncpus; i++) {
+		cpptr = &cputab[i];
+		if (cpptr == self || cpptr->cpstate != CPU_ONLINE
+		    || (cpptr->cpreadymap & ~1) == 0) {
+			continue;	/* Idle processes stay on band 0*/
+		}
+		band = HighBit(cpptr->cpreadymap);
+		if (band > best) {
+			best = band;
+			victim = cpptr;
+		}
+	}
+	if (victim == NULL) {
+		return;
+	}
+	pid = firstid(readyq(victim, best));
+	readyat = proctab[pid].prreadyat;
+	readyremove(pid);
+	proctab[pid].prcpu = self->cpindex;
+	readyinsert(pid, proctab[pid].prprio);
+	proctab[pid].prreadyat = readyat;
+}
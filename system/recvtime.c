@@ -23,7 +23,7 @@ umsg32	recvtime(
 
 	prptr = &proctab[currpid];
 	if (prptr->prhasmsg == FALSE) {	/* Delay if no message waiting	*/
-		if (insertd(currpid,sleepq,maxwait) == SYSERR) {
+		if (sleepinsert(currpid, maxwait) == SYSERR) {
 			restore(mask);
 			return SYSERR;
 		}
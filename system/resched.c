@@ -2,7 +2,11 @@
 
 #include <xinu.h>
 
+extern	void	deallocstk(uint32);
+
 struct	defer	Defer;
+uint32	cr3loads;		/* Context switches that reloaded CR3	*/
+uint32	cr3skips;		/* Context switches that kept CR3	*/
 
 /*------------------------------------------------------------------------
  *  resched  -  Reschedule processor to highest priority eligible process
@@ -12,40 +16,108 @@ void	resched(void)		/* Assumes interrupts are disabled	*/
 {
 	struct procent *ptold;	/* Ptr to table entry for old process	*/
 	struct procent *ptnew;	/* Ptr to table entry for new process	*/
+	struct cpuent *cpptr;	/* Ptr to entry of this processor	*/
+	uint32	pgdir;		/* Page directory to run ptnew in	*/
+	uint64	now;		/* CPU accounting stamp of the switch	*/
+	pid32	oldpid;		/* ID of the old process		*/
 
 	/* If rescheduling is deferred, record attempt and return */
-	pid32 oldpid = currpid;
+
 	if (Defer.ndefers > 0) {
 		Defer.attempt = TRUE;
 		return;
 	}
+	cpptr = cpuself();
+
+	/* Free the address space of a process that killed itself on	*/
+	/*   this processor, now that nothing runs on its stack		*/
+
+	if (cpptr->cpreap != 0) {
+		pgdir = cpptr->cpreap;
+		cpptr->cpreap = 0;
+		deallocstk(pgdir);
+	}
+
+	/* Account for ticks that passed with the periodic tick stopped;*/
+	/*   processes it wakes are considered below			*/
+
+	if (clktickless != 0) {
+		Defer.ndefers++;
+		clkwake(FALSE);
+		Defer.ndefers--;
+	}
 
 	/* Point to process table entry for the current (old) process */
 
-	ptold = &proctab[currpid];
+	oldpid = currpid;
+	ptold = &proctab[oldpid];
+
+	/* With nothing but the idle process left to run here, take	*/
+	/*   work that waits on another processor			*/
+
+	if (ncpuonline > 1 && (cpptr->cpreadymap & ~1) == 0
+	    && (ptold->prstate != PR_CURR || oldpid == cpptr->cpidlepid)) {
+		readysteal();
+	}
 
 	if (ptold->prstate == PR_CURR) {  /* Process remains eligible */
-		if (ptold->prprio > firstkey(readylist)) {
+		if (readyfirst(oldpid)) {
 			return;
 		}
 
 		/* Old process will no longer remain current */
 
 		ptold->prstate = PR_READY;
-		insert(currpid, readylist, ptold->prprio);
+		readyinsert(oldpid, ptold->prprio);
 	}
 
+	/* Charge the old process up to now before switching */
+
+	now = cpucharge();
+
 	/* Force context switch to highest priority ready process */
 
-	currpid = dequeue(readylist);
+	cpptr->cpcurrpid = readyget();
 	ptnew = &proctab[currpid];
+	ptnew->prwaittime += now - ptnew->prreadyat;
+	if (ptnew != ptold) {
+		if (ptold->prstate == PR_READY) {
+			ptold->prinvolsw++;
+		} else {
+			ptold->prvolsw++;
+		}
+	}
 	ptnew->prstate = PR_CURR;
-	preempt = QUANTUM;		/* Reset time slice for process	*/
+	cpptr->cppreempt = QUANTUM;	/* Reset time slice for process	*/
 	// kprintf("[I](resched) (pid: %d, prname: %s) -> (pid: %d, prname: %s)\n", oldpid, proctab[oldpid].prname, currpid, proctab[currpid].prname);
-	ctxsw(&ptold->prstkptr, &ptnew->prstkptr, (void *)ptnew->phypgdir);
 
-	/* Old process returns here when resumed */
+	/* The idle process only touches kernel mappings, which every	*/
+	/*   page directory shares, so it borrows the address space of	*/
+	/*   the process it interrupts unless that process is gone; the	*/
+	/*   address space of a process that killed itself is freed by	*/
+	/*   the next resched here					*/
+
+	pgdir = ptnew->phypgdir;
+	if (ptold->prstate == PR_FREE) {
+		cpptr->cpreap = ptold->phypgdir;
+	} else if (currpid == cpptr->cpidlepid) {
+		pgdir = ReadCr3();
+	}
+	cpptr->cpcr3 = pgdir;
+
+	/* The first FPU instruction of the new process traps, unless	*/
+	/*   the FPU still holds its state				*/
+
+	fpuswitch(currpid);
+	ctxsw(&ptold->prstkptr, &ptnew->prstkptr, (void *)pgdir);
 
+	/* Old process returns here when resumed, perhaps on another	*/
+	/*   processor; carry out a kill or suspend asked of it while	*/
+	/*   it ran elsewhere						*/
+
+	if (proctab[currpid].prreq != 0) {
+		cpurequest(currpid);
+	}
 	return;
 }
 
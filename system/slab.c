@@ -0,0 +1,320 @@
+/* slab.c - cacheinit, cache_create, cache_ctor, cache_alloc, cache_free,	*/
+/*		cache_reclaim, cache_delete					*/
+
+#include <xinu.h>
+
+struct	caentry	cachetab[NCACHE];	/* Object cache table		*/
+
+/*------------------------------------------------------------------------
+ *  slab_link  -  Insert a slab at the head of a cache list
+ *------------------------------------------------------------------------
+ */
+local	void	slab_link(
+	  struct slab	**head,		/* Head of the list		*/
+	  struct slab	*slptr		/* Slab to insert		*/
+	)
+{
+	slptr->slprev = NULL;
+	slptr->slnext = *head;
+	if (*head != NULL) {
+		(*head)->slprev = slptr;
+	}
+	*head = slptr;
+}
+
+/*------------------------------------------------------------------------
+ *  slab_unlink  -  Remove a slab from a cache list
+ *------------------------------------------------------------------------
+ */
+local	void	slab_unlink(
+	  struct slab	**head,		/* Head of the list		*/
+	  struct slab	*slptr		/* Slab to remove		*/
+	)
+{
+	if (slptr->slprev != NULL) {
+		slptr->slprev->slnext = slptr->slnext;
+	} else {
+		*head = slptr->slnext;
+	}
+	if (slptr->slnext != NULL) {
+		slptr->slnext->slprev = slptr->slprev;
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  slab_release  -  Return an empty slab's page to the frame allocator
+ *------------------------------------------------------------------------
+ */
+local	void	slab_release(
+	  struct caentry *captr,	/* Cache owning the slab	*/
+	  struct slab	*slptr		/* Empty slab on capartial	*/
+	)
+{
+	slab_unlink(&captr->capartial, slptr);
+	slptr->slmagic = 0;
+	captr->canslabs--;
+	captr->canempty--;
+	FreeOnePage((struct page *)(is_page ? virt_to_phys(slptr)
+					    : (uint32)slptr));
+}
+
+/*------------------------------------------------------------------------
+ *  cacheinit  -  Initialize the object cache table
+ *------------------------------------------------------------------------
+ */
+status	cacheinit(void)
+{
+	int32	i;
+
+	for (i = 0; i < NCACHE; i++) {
+		cachetab[i].castate = CA_FREE;
+	}
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  cache_create  -  Create a cache of objects of a fixed size
+ *------------------------------------------------------------------------
+ */
+cid32	cache_create(
+	  uint32	size,		/* Object size in bytes		*/
+	  uint32	align		/* Object alignment, a power of	*/
+					/*   two (0 means 8 bytes)	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	cid32	cache;			/* ID of the new cache		*/
+	struct	caentry	*captr;		/* Ptr to cache table entry	*/
+	uint32	offset;			/* Offset of the first object	*/
+	uint32	perslab;		/* Objects that fit in a slab	*/
+
+	if (align == 0) {
+		align = ALIGNMENT;
+	}
+	if (size == 0 || (align & (align - 1)) != 0 || align >= PAGE_SIZE) {
+		return (cid32)SYSERR;
+	}
+	size = (size + align - 1) & ~(align - 1);
+	offset = (sizeof(struct slab) + align - 1) & ~(align - 1);
+	if (size > PAGE_SIZE - offset) {
+		return (cid32)SYSERR;
+	}
+	perslab = (PAGE_SIZE - offset) / size;
+	if (perslab > SLAB_MAXOBJ) {
+		perslab = SLAB_MAXOBJ;
+	}
+
+	mask = disable();
+	for (cache = 0; cache < NCACHE; cache++) {
+		if (cachetab[cache].castate == CA_FREE) {
+			break;
+		}
+	}
+	if (cache >= NCACHE) {
+		restore(mask);
+		return (cid32)SYSERR;
+	}
+	captr = &cachetab[cache];
+	memset(captr, 0, sizeof(struct caentry));
+	captr->castate = CA_USED;
+	captr->casize = size;
+	captr->caoffset = offset;
+	captr->caperslab = perslab;
+	restore(mask);
+	return cache;
+}
+
+/*------------------------------------------------------------------------
+ *  cache_ctor  -  Set the constructor run on each object of a new slab
+ *		   (objects go back to the cache in constructed state)
+ *------------------------------------------------------------------------
+ */
+status	cache_ctor(
+	  cid32		cache,		/* ID of the cache		*/
+	  void		(*ctor)(void *)	/* Constructor, or NULL		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+
+	mask = disable();
+	if (isbadcache(cache)) {
+		restore(mask);
+		return SYSERR;
+	}
+	cachetab[cache].cactor = ctor;
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  cache_alloc  -  Allocate an object from a cache, NULL if none
+ *------------------------------------------------------------------------
+ */
+void	*cache_alloc(
+	  cid32		cache		/* ID of the cache		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	caentry	*captr;		/* Ptr to cache table entry	*/
+	struct	slab	*slptr;		/* Slab the object comes from	*/
+	uint32	frame;			/* Frame of a new slab		*/
+	char	*obj;			/* Object to return		*/
+	int32	i;
+
+	mask = disable();
+	if (isbadcache(cache)) {
+		restore(mask);
+		return NULL;
+	}
+	captr = &cachetab[cache];
+	slptr = captr->capartial;
+	if (slptr != NULL) {
+		captr->cahits++;
+	} else {
+
+		/* No free object left: build a new slab in a fresh page */
+
+		frame = (uint32)GetPages(0);
+		if (frame == 0) {
+			restore(mask);
+			return NULL;
+		}
+		captr->camisses++;
+		slptr = (struct slab *)(is_page ? (uint32)phys_to_virt(frame)
+						: frame);
+		slptr->slmagic = SLAB_MAGIC;
+		slptr->slcache = cache;
+		slptr->slinuse = 0;
+		memset(slptr->slmap, 0, sizeof(slptr->slmap));
+		for (i = 0; i < captr->caperslab; i++) {
+			slptr->slmap[i / 32] |= 1 << (i % 32);
+			if (captr->cactor != NULL) {
+				captr->cactor((char *)slptr + captr->caoffset
+						+ i * captr->casize);
+			}
+		}
+		slab_link(&captr->capartial, slptr);
+		captr->canslabs++;
+		captr->canempty++;
+	}
+
+	/* Take the lowest free object of the slab */
+
+	for (i = 0; slptr->slmap[i] == 0; i++) {
+		;
+	}
+	obj = (char *)slptr + captr->caoffset
+		+ (i * 32 + LowBit(slptr->slmap[i])) * captr->casize;
+	slptr->slmap[i] &= slptr->slmap[i] - 1;
+	if (slptr->slinuse++ == 0) {
+		captr->canempty--;
+	}
+	if (slptr->slinuse == captr->caperslab) {
+		slab_unlink(&captr->capartial, slptr);
+		slab_link(&captr->cafull, slptr);
+	}
+	captr->cainuse++;
+	restore(mask);
+	return obj;
+}
+
+/*------------------------------------------------------------------------
+ *  cache_free  -  Return an object to the cache it came from
+ *------------------------------------------------------------------------
+ */
+syscall	cache_free(
+	  cid32		cache,		/* ID of the cache		*/
+	  void		*obj		/* Object from cache_alloc	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	caentry	*captr;		/* Ptr to cache table entry	*/
+	struct	slab	*slptr;		/* Slab holding the object	*/
+	uint32	off;			/* Offset of obj past caoffset	*/
+	uint32	i;			/* Index of obj in its slab	*/
+
+	mask = disable();
+	if (isbadcache(cache)) {
+		restore(mask);
+		return SYSERR;
+	}
+	captr = &cachetab[cache];
+	slptr = (struct slab *)((uint32)obj & ~(PAGE_SIZE - 1));
+	off = (uint32)obj - (uint32)slptr - captr->caoffset;
+	i = off / captr->casize;
+	if (slptr->slmagic != SLAB_MAGIC || slptr->slcache != cache
+	    || (uint32)obj - (uint32)slptr < captr->caoffset
+	    || off % captr->casize != 0 || i >= captr->caperslab
+	    || (slptr->slmap[i / 32] & (1 << (i % 32)))) {
+		restore(mask);
+		return SYSERR;
+	}
+	slptr->slmap[i / 32] |= 1 << (i % 32);
+	if (slptr->slinuse-- == captr->caperslab) {
+		slab_unlink(&captr->cafull, slptr);
+		slab_link(&captr->capartial, slptr);
+	}
+	if (slptr->slinuse == 0) {
+		captr->canempty++;
+	}
+	captr->cainuse--;
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  cache_reclaim  -  Give the pages of all empty slabs back to the frame
+ *		      allocator; returns the number of pages freed
+ *------------------------------------------------------------------------
+ */
+int32	cache_reclaim(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	caentry	*captr;		/* Ptr to cache table entry	*/
+	struct	slab	*slptr, *next;	/* Walk the partial slabs	*/
+	int32	freed;			/* Pages given back		*/
+	int32	i;
+
+	mask = disable();
+	freed = 0;
+	for (i = 0; i < NCACHE; i++) {
+		captr = &cachetab[i];
+		if (captr->castate != CA_USED || captr->canempty == 0) {
+			continue;
+		}
+		for (slptr = captr->capartial; slptr != NULL; slptr = next) {
+			next = slptr->slnext;
+			if (slptr->slinuse == 0) {
+				slab_release(captr, slptr);
+				freed++;
+			}
+		}
+	}
+	restore(mask);
+	return freed;
+}
+
+/*------------------------------------------------------------------------
+ *  cache_delete  -  Delete a cache whose objects have all been freed
+ *------------------------------------------------------------------------
+ */
+syscall	cache_delete(
+	  cid32		cache		/* ID of the cache		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	caentry	*captr;		/* Ptr to cache table entry	*/
+
+	mask = disable();
+	if (isbadcache(cache) || cachetab[cache].cainuse != 0) {
+		restore(mask);
+		return SYSERR;
+	}
+	captr = &cachetab[cache];
+	while (captr->capartial != NULL) {
+		slab_release(captr, captr->capartial);
+	}
+	captr->castate = CA_FREE;
+	restore(mask);
+	return OK;
+}
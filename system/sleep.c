@@ -1,4 +1,4 @@
-/* sleep.c - sleep sleepms */
+/* sleep.c - sleep sleepms sleepus */
 
 #include <xinu.h>
 
@@ -41,7 +41,7 @@ syscall	sleepms(
 	/* Delay calling process */
 
 	mask = disable();
-	if (insertd(currpid, sleepq, delay) == SYSERR) {
+	if (sleepinsert(currpid, delay) == SYSERR) {
 		restore(mask);
 		return SYSERR;
 	}
@@ -51,3 +51,34 @@ syscall	sleepms(
 	restore(mask);
 	return OK;
 }
+
+/*------------------------------------------------------------------------
+ *  sleepus  -  Delay the calling process n microseconds; without a TSC
+ *		the delay is rounded up to whole milliseconds
+ *------------------------------------------------------------------------
+ */
+syscall	sleepus(
+	  int32	delay			/* Time to delay in usec.	*/
+	)
+{
+	uint64	end;			/* Time to return at, in ns	*/
+
+	if (delay < 0) {
+		return SYSERR;
+	}
+	if (tschz == 0) {
+		return sleepms(delay / 1000 + (delay % 1000 != 0));
+	}
+
+	/* Sleep through all but the last tick, which can end early,	*/
+	/*   then wait out the rest on the TSC				*/
+
+	end = getnanos() + (uint64)delay * 1000;
+	if (delay >= 2000) {
+		sleepms(delay / 1000 - 1);
+	}
+	while (getnanos() < end) {
+		;
+	}
+	return OK;
+}
@@ -0,0 +1,210 @@
+/* sleepq.c - sleepinsert, sleeptick, sleepnext, sleepswitch */
+
+#include <xinu.h>
+
+qid16	sleepwheel;		/* First queue of the timing wheel	*/
+uint32	sleepbase;		/* Tick the clock handler does next	*/
+int32	sleepkind;		/* SLP_WHEEL or SLP_DELTA		*/
+uint32	sleepcyc;		/* Cycles spent on ticks by the clock	*/
+uint32	sleepmax;		/* Most cycles spent on a single tick	*/
+uint32	sleepopcyc;		/* Cycles spent inserting and removing	*/
+uint32	sleepops;		/* Sleepers inserted and removed	*/
+
+/*------------------------------------------------------------------------
+ *  wheeladd  -  Put a process on the wheel queue for an absolute tick:
+ *		 level l holds expiries less than SLPSLOTS^(l+1) ticks
+ *		 away, hashed on bits SLPBITS*l and up of the tick
+ *------------------------------------------------------------------------
+ */
+local	void	wheeladd(
+	  pid32		pid,		/* ID of process to insert	*/
+	  uint32	expires		/* Tick at which it wakes up	*/
+	)
+{
+	int32	diff;			/* Ticks until expires		*/
+	int32	level;			/* Wheel level to use		*/
+	uint32	slot;			/* Slot of that level		*/
+
+	diff = (int32)(expires - sleepbase);
+	if (diff < SLPSLOTS) {
+		level = 0;
+		slot = (diff < 0 ? sleepbase : expires) & (SLPSLOTS - 1);
+	} else {
+		level = HighBit(diff) / SLPBITS;
+		slot = (expires >> (SLPBITS * level)) & (SLPSLOTS - 1);
+	}
+	enqueue(pid, sleepslot(level, slot));
+	queuetab[pid].qkey = expires;
+}
+
+/*------------------------------------------------------------------------
+ *  sleepinsert  -  Put a process to sleep for delay ticks
+ *------------------------------------------------------------------------
+ */
+status	sleepinsert(			/* Assumes interrupts disabled	*/
+	  pid32		pid,		/* ID of process to insert	*/
+	  int32		delay		/* Delay from "now" (in ms.)	*/
+	)
+{
+	uint64	start;			/* Cycle counter at the start	*/
+
+	if (isbadpid(pid) || delay < 0) {
+		return SYSERR;
+	}
+	/* Delays count from now, so catch up on a stopped tick first	*/
+
+	if (clktickless != 0) {
+		clkwake(FALSE);
+	}
+
+	start = getticks();
+	if (sleepkind == SLP_DELTA) {
+		insertd(pid, sleepq, delay);
+	} else {
+		wheeladd(pid, sleepbase + delay - 1);
+	}
+	sleepopcyc += (uint32)(getticks() - start);
+	sleepops++;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  sleeptick  -  Called by the clock interrupt handler every tick to
+ *		  awaken the processes whose delay has run out
+ *------------------------------------------------------------------------
+ */
+void	sleeptick(void)
+{
+	uint64	start;			/* Cycle counter at the start	*/
+	uint32	cycles;			/* Cycles taken by this tick	*/
+	uint32	slot;			/* Current slot of a level	*/
+	int32	level;			/* Level being cascaded		*/
+	qid16	q;			/* Wheel queue			*/
+	pid32	pid;
+
+	start = getticks();
+	if (sleepkind == SLP_DELTA) {
+
+		/* Decrement the delay for the first process on the	*/
+		/*   sleep queue, and awaken if the count reaches zero	*/
+
+		if (!isempty(sleepq)
+		    && (--queuetab[firstid(sleepq)].qkey) <= 0) {
+			wakeup();
+		}
+	} else {
+
+		/* When level 0 wraps, move the processes of the next	*/
+		/*   slot of each higher level that wrapped down a level*/
+
+		slot = sleepbase & (SLPSLOTS - 1);
+		for (level = 1; slot == 0 && level < SLPLEVELS; level++) {
+			slot = (sleepbase >> (SLPBITS * level))
+					& (SLPSLOTS - 1);
+			q = sleepslot(level, slot);
+			while (nonempty(q)) {
+				pid = getfirst(q);
+				wheeladd(pid, queuetab[pid].qkey);
+			}
+		}
+
+		/* Every process in the current slot expires now	*/
+
+		q = sleepslot(0, sleepbase & (SLPSLOTS - 1));
+		if (nonempty(q)) {
+			resched_cntl(DEFER_START);
+			while (nonempty(q)) {
+				ready(getfirst(q));
+			}
+			resched_cntl(DEFER_STOP);
+		}
+	}
+	sleepbase++;
+	cycles = (uint32)(getticks() - start);
+	sleepcyc += cycles;
+	if (cycles > sleepmax) {
+		sleepmax = cycles;
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  sleepnext  -  Number of ticks up to the next one that has sleepers
+ *		  to awaken or move, or maxticks if none comes sooner
+ *------------------------------------------------------------------------
+ */
+uint32	sleepnext(			/* Assumes interrupts disabled	*/
+	  uint32	maxticks	/* Most ticks to look ahead	*/
+	)
+{
+	uint32	i;			/* Ticks from now		*/
+	uint32	tick;			/* Tick at which level 0 wraps	*/
+	uint32	slot;			/* Slot of a level at that tick	*/
+	int32	level;			/* Level moved down at the wrap	*/
+
+	if (sleepkind == SLP_DELTA) {
+		if (isempty(sleepq)) {
+			return maxticks;
+		}
+		i = firstkey(sleepq) < 1 ? 1 : firstkey(sleepq);
+		return i < maxticks ? i : maxticks;
+	}
+
+	/* Level 0 holds the sleepers of the next SLPSLOTS ticks, one	*/
+	/*   slot per tick						*/
+
+	for (i = 0; i < maxticks && i < SLPSLOTS; i++) {
+		if (nonempty(sleepslot(0, (sleepbase + i) & (SLPSLOTS - 1)))) {
+			maxticks = i + 1;
+			break;
+		}
+	}
+
+	/* Sleepers of the higher levels move down when level 0 wraps;	*/
+	/*   only a wrap that moves some needs the tick to run		*/
+
+	tick = (sleepbase + SLPSLOTS - 1) & ~(SLPSLOTS - 1);
+	for (i = tick - sleepbase; i < maxticks; i += SLPSLOTS) {
+		tick = sleepbase + i;
+		for (level = 1; level < SLPLEVELS; level++) {
+			slot = (tick >> (SLPBITS * level)) & (SLPSLOTS - 1);
+			if (nonempty(sleepslot(level, slot))) {
+				return i + 1;
+			}
+			if (slot != 0) {
+				break;
+			}
+		}
+	}
+	return maxticks;
+}
+
+/*------------------------------------------------------------------------
+ *  sleepswitch  -  Choose the sleep queue design (SLP_WHEEL or
+ *		    SLP_DELTA); only allowed while no process sleeps
+ *------------------------------------------------------------------------
+ */
+status	sleepswitch(
+	  int32		kind		/* Design to use from now on	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	i;
+
+	if (kind != SLP_WHEEL && kind != SLP_DELTA) {
+		return SYSERR;
+	}
+	mask = disable();
+	if (nonempty(sleepq)) {
+		restore(mask);
+		return SYSERR;
+	}
+	for (i = 0; i < SLPLEVELS * SLPSLOTS; i++) {
+		if (nonempty(sleepwheel + 2 * i)) {
+			restore(mask);
+			return SYSERR;
+		}
+	}
+	sleepkind = kind;
+	restore(mask);
+	return OK;
+}
@@ -0,0 +1,796 @@
+/* smp.c - smpinit, smpboot, apmain, getcpu, klockacquire, klockrelease,	*/
+/*		cpuipi, ipihandler, cpurequest, tlbshootdown, tlbevict	*/
+
+#include <xinu.h>
+
+struct	cpuent	cputab[NCPU];	/* Processors, BSP first		*/
+int32	ncpus;			/* Processors found			*/
+int32	ncpuonline;		/* Processors running			*/
+uint32	lapicphys;		/* Physical address of the local APICs	*/
+uint32	ioapicphys;		/* Physical address of the I/O APIC	*/
+volatile uint32	*lapic;		/* Mapped local APIC, NULL if none	*/
+volatile uint32	*ioapic;	/* Mapped I/O APIC, NULL if none	*/
+uint32	irqgsi[NISAIRQ];	/* I/O APIC input of each ISA IRQ	*/
+
+struct	spinlock klock = { 1 };	/* Kernel lock, held by the BSP	*/
+					/*   until nulluser enables	*/
+
+local	volatile uint32	tlbpending;	/* CPUs yet to flush their TLB	*/
+local	uint32	tlbpgdir;		/* Page directory shot down	*/
+local	bool8	tlbleave;		/* Its borrowers must leave it	*/
+#ifdef SMP
+local	uint32	apstk[NCPU][APSTK / sizeof(uint32)];	/* AP stacks	*/
+#endif
+
+extern	char	apstart[], apend[];	/* AP startup code, apstart.S	*/
+extern	char	apgdtr[], apcr3[], apcr4[], apstack[];
+
+#define	APFIELD(f)	((uint32 *)(APBOOT + ((f) - apstart)))
+
+/* ACPI root system description pointer and table header */
+
+struct	acpirsdp {
+	char	rsdsig[8];		/* "RSD PTR "			*/
+	byte	rsdsum;			/* Checksum of the first 20	*/
+	char	rsdoem[6];
+	byte	rsdrev;
+	uint32	rsdrsdt;		/* Physical address of the RSDT	*/
+};
+
+struct	acpihdr	{
+	char	ahsig[4];		/* "RSDT", "APIC" (the MADT)...	*/
+	uint32	ahlen;			/* Bytes, header included	*/
+	byte	ahrev;
+	byte	ahsum;			/* All bytes add up to zero	*/
+	char	ahoem[6];
+	char	ahtable[8];
+	uint32	ahoemrev;
+	uint32	ahcreator;
+	uint32	ahcrrev;
+};
+
+#define	MADT_LAPIC	0		/* MADT entry: processor	*/
+#define	MADT_IOAPIC	1		/* MADT entry: I/O APIC		*/
+#define	MADT_OVERRIDE	2		/* MADT entry: ISA IRQ moved	*/
+
+/* Intel MultiProcessor specification floating pointer and table */
+
+struct	mpfloat	{
+	char	mfsig[4];		/* "_MP_"			*/
+	uint32	mfconfig;		/* Physical address of table	*/
+	byte	mflen;			/* Length in 16-byte units	*/
+	byte	mfrev;
+	byte	mfsum;
+	byte	mffeat[5];
+};
+
+struct	mpconfig {
+	char	mcsig[4];		/* "PCMP"			*/
+	uint16	mclen;
+	byte	mcrev;
+	byte	mcsum;
+	char	mcoem[8];
+	char	mcprod[12];
+	uint32	mcoemtab;
+	uint16	mcoemlen;
+	uint16	mccount;		/* Entries after the header	*/
+	uint32	mclapic;		/* Address of the local APICs	*/
+	uint16	mcextlen;
+	byte	mcextsum;
+	byte	mcres;
+};
+
+#define	MP_PROC		0		/* MP entry: processor (20 B)	*/
+#define	MP_IOAPIC	2		/* MP entry: I/O APIC (8 B)	*/
+
+/*------------------------------------------------------------------------
+ *  smpphys  -  Return the direct map address of a physical range, NULL
+ *		  if it is not mapped
+ *------------------------------------------------------------------------
+ */
+local	byte	*smpphys(
+	  uint32	paddr,		/* Physical address		*/
+	  uint32	len		/* Bytes needed			*/
+	)
+{
+	if (paddr == 0 || paddr + len < paddr
+	    || paddr + len > (ndmpdes << 22)) {
+		return NULL;
+	}
+	return (byte *)phys_to_virt(paddr);
+}
+
+/*------------------------------------------------------------------------
+ *  smpsum  -  Add up len bytes; firmware tables sum to zero
+ *------------------------------------------------------------------------
+ */
+local	byte	smpsum(
+	  byte		*p,		/* Start of the table		*/
+	  uint32	len		/* Its length in bytes		*/
+	)
+{
+	byte	sum;			/* Sum of the bytes so far	*/
+
+	for (sum = 0; len > 0; len--) {
+		sum += *p++;
+	}
+	return sum;
+}
+
+/*------------------------------------------------------------------------
+ *  smpscan  -  Search 16-byte boundaries of a physical range for a
+ *		  signature followed by a valid checksum
+ *------------------------------------------------------------------------
+ */
+local	byte	*smpscan(
+	  uint32	paddr,		/* Start of the range		*/
+	  uint32	len,		/* Its length in bytes		*/
+	  char		*sig,		/* Signature to look for	*/
+	  uint32	siglen,		/* Bytes in the signature	*/
+	  uint32	sumlen		/* Bytes covered by the checksum*/
+	)
+{
+	byte	*p, *end;		/* Walk through the range	*/
+
+	p = smpphys(paddr, len);
+	if (p == NULL) {
+		return NULL;
+	}
+	for (end = p + len - sumlen; p <= end; p += 16) {
+		if (memcmp(p, sig, siglen) == 0 && smpsum(p, sumlen) == 0) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+/*------------------------------------------------------------------------
+ *  smpebda  -  Find a structure the firmware leaves in the first KB of
+ *		  the extended BIOS data area or in the BIOS ROM
+ *------------------------------------------------------------------------
+ */
+local	byte	*smpebda(
+	  uint32	rombase,	/* Start of the ROM area to scan*/
+	  char		*sig,		/* Signature to look for	*/
+	  uint32	siglen,		/* Bytes in the signature	*/
+	  uint32	sumlen		/* Bytes covered by the checksum*/
+	)
+{
+	uint32	ebda;			/* Physical address of the EBDA	*/
+	byte	*p;
+
+	ebda = *(uint16 *)phys_to_virt(0x40e) << 4;
+	if (ebda == 0) {
+		ebda = 0x9fc00;		/* Last KB of base memory	*/
+	}
+	p = smpscan(ebda, 1024, sig, siglen, sumlen);
+	if (p == NULL) {
+		p = smpscan(rombase, 0x100000 - rombase, sig, siglen, sumlen);
+	}
+	return p;
+}
+
+/*------------------------------------------------------------------------
+ *  smpfound  -  Record a processor the firmware lists
+ *------------------------------------------------------------------------
+ */
+local	void	smpfound(
+	  uint32	apicid		/* ID of its local APIC		*/
+	)
+{
+	if (ncpus >= NCPU) {
+		return;
+	}
+	cputab[ncpus].cpstate = CPU_FOUND;
+	cputab[ncpus].cpapicid = apicid;
+	cputab[ncpus].cpcr3 = KERNEL_PGDIR;
+	cputab[ncpus].cpipis = 0;
+	ncpus++;
+}
+
+/*------------------------------------------------------------------------
+ *  smpacpi  -  Find the processors and I/O APIC in the ACPI MADT
+ *------------------------------------------------------------------------
+ */
+local	status	smpacpi(void)
+{
+	struct	acpirsdp *rsdp;		/* Root pointer			*/
+	struct	acpihdr	*rsdt, *madt;	/* Root table, APIC table	*/
+	uint32	*entries;		/* Tables the RSDT points to	*/
+	byte	*p, *end;		/* Walk the MADT entries	*/
+	int32	i, n;
+
+	rsdp = (struct acpirsdp *)smpebda(0xe0000, "RSD PTR ", 8, 20);
+	if (rsdp == NULL) {
+		return SYSERR;
+	}
+	rsdt = (struct acpihdr *)smpphys(rsdp->rsdrsdt,
+					sizeof(struct acpihdr));
+	if (rsdt == NULL || memcmp(rsdt->ahsig, "RSDT", 4) != 0
+	    || smpphys(rsdp->rsdrsdt, rsdt->ahlen) == NULL
+	    || smpsum((byte *)rsdt, rsdt->ahlen) != 0) {
+		return SYSERR;
+	}
+	entries = (uint32 *)(rsdt + 1);
+	n = (rsdt->ahlen - sizeof(struct acpihdr)) / sizeof(uint32);
+	madt = NULL;
+	for (i = 0; i < n; i++) {
+		madt = (struct acpihdr *)smpphys(entries[i],
+					sizeof(struct acpihdr));
+		if (madt != NULL && memcmp(madt->ahsig, "APIC", 4) == 0
+		    && smpphys(entries[i], madt->ahlen) != NULL
+		    && smpsum((byte *)madt, madt->ahlen) == 0) {
+			break;
+		}
+		madt = NULL;
+	}
+	if (madt == NULL) {
+		return SYSERR;
+	}
+
+	/* Local APIC address, flags, then variable-length entries	*/
+
+	p = (byte *)(madt + 1);
+	lapicphys = *(uint32 *)p;
+	end = (byte *)madt + madt->ahlen;
+	for (p += 8; p + 2 <= end && p[1] >= 2; p += p[1]) {
+		if (p[0] == MADT_LAPIC && (*(uint32 *)(p + 4) & 1)) {
+			smpfound(p[3]);
+		} else if (p[0] == MADT_IOAPIC && ioapicphys == 0) {
+			ioapicphys = *(uint32 *)(p + 4);
+		} else if (p[0] == MADT_OVERRIDE && p[2] == 0
+			   && p[3] < NISAIRQ) {
+			irqgsi[p[3]] = *(uint32 *)(p + 4);
+		}
+	}
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  smpmp  -  Find the processors and I/O APIC in the MP configuration
+ *		table of older firmware
+ *------------------------------------------------------------------------
+ */
+local	status	smpmp(void)
+{
+	struct	mpfloat	*mfptr;		/* Floating pointer		*/
+	struct	mpconfig *mcptr;	/* Configuration table		*/
+	byte	*p;			/* Walks the table entries	*/
+	int32	i;
+
+	mfptr = (struct mpfloat *)smpebda(0xf0000, "_MP_", 4, 16);
+	if (mfptr == NULL || mfptr->mfconfig == 0) {
+		return SYSERR;		/* None, or a default config	*/
+	}
+	mcptr = (struct mpconfig *)smpphys(mfptr->mfconfig,
+					sizeof(struct mpconfig));
+	if (mcptr == NULL || memcmp(mcptr->mcsig, "PCMP", 4) != 0
+	    || smpphys(mfptr->mfconfig, mcptr->mclen) == NULL
+	    || smpsum((byte *)mcptr, mcptr->mclen) != 0) {
+		return SYSERR;
+	}
+	lapicphys = mcptr->mclapic;
+	p = (byte *)(mcptr + 1);
+	for (i = 0; i < mcptr->mccount; i++) {
+		if (p[0] == MP_PROC) {
+			if (p[3] & 1) {		/* Usable		*/
+				smpfound(p[1]);
+			}
+			p += 20;
+		} else {
+			if (p[0] == MP_IOAPIC && (p[3] & 1)
+			    && ioapicphys == 0) {
+				ioapicphys = *(uint32 *)(p + 4);
+			}
+			p += 8;
+		}
+	}
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  smpmmio  -  Map the APIC registers uncached in the kernel page
+ *		  directory, from where allocstk copies them
+ *------------------------------------------------------------------------
+ */
+local	void	smpmmio(void)
+{
+	struct	page	*kdir;		/* Kernel page directory	*/
+	struct	page	*tbl;		/* Page table of the MMIO area	*/
+	uint32	ptab;			/* Its physical address		*/
+	int32	i;
+
+	kdir = (struct page *)KERNEL_PGDIR;
+	ptab = (uint32)GetOnePage();
+	tbl = (struct page *)phys_to_virt(ptab);
+	for (i = 0; i < 1024; i++) {
+		tbl->entries[i] = (MMIO_PHYS + i * PAGE_SIZE) | PTE_P | PTE_W
+				| PTE_PCD | PTE_PWT | (vm_pge ? PTE_G : 0);
+	}
+	kdir->entries[MMIO_PDE] = ptab | PTE_P | PTE_W;
+	lapic = (volatile uint32 *)(MMIO_BASE + lapicphys - MMIO_PHYS);
+	if (ioapicphys >= MMIO_PHYS
+	    && ioapicphys < MMIO_PHYS + MMIO_SIZE) {
+		ioapic = (volatile uint32 *)(MMIO_BASE + ioapicphys
+					- MMIO_PHYS);
+	}
+}
+
+#ifdef SMP
+/*------------------------------------------------------------------------
+ *  smpdelay  -  Busy-wait for a number of microseconds
+ *------------------------------------------------------------------------
+ */
+local	void	smpdelay(
+	  uint32	usecs		/* Microseconds to wait		*/
+	)
+{
+	uint64	end;			/* Time to stop waiting		*/
+
+	if (tschz == 0) {
+		DELAY(usecs);
+		return;
+	}
+	end = getnanos() + (uint64)usecs * 1000;
+	while (getnanos() < end) {
+		;
+	}
+}
+
+#endif
+
+/*------------------------------------------------------------------------
+ *  lapicipi  -  Send an interprocessor interrupt and wait until the
+ *		   local APIC has delivered it
+ *------------------------------------------------------------------------
+ */
+local	void	lapicipi(
+	  uint32	apicid,		/* Destination local APIC	*/
+	  uint32	cmd		/* Delivery mode and vector	*/
+	)
+{
+	lapic[LAPIC_ICRHI] = apicid << 24;
+	lapic[LAPIC_ICRLO] = cmd;
+	while (lapic[LAPIC_ICRLO] & ICR_PENDING) {
+		asm volatile("pause");
+	}
+}
+
+#ifdef SMP
+/*------------------------------------------------------------------------
+ *  smpidle  -  Set up the idle process of an AP, which the AP becomes
+ *		  when it starts, as the BSP becomes the null process
+ *------------------------------------------------------------------------
+ */
+local	pid32	smpidle(
+	  int32		cpu		/* Index in cputab		*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to its process entry	*/
+	pid32	pid;			/* Its process ID		*/
+	int32	i;
+
+	pid = newpid();
+	if (pid == SYSERR) {
+		return SYSERR;
+	}
+	prptr = &proctab[pid];
+	prptr->prstate = PR_CURR;
+	prptr->prprio = 0;
+	sprintf(prptr->prname, "prnull%d", cpu);
+	prptr->phypgdir = KERNEL_PGDIR;
+	prptr->prstkbase = (char *)&apstk[cpu][APSTK / sizeof(uint32) - 1];
+	prptr->prstklen = APSTK;
+	prptr->prstkptr = (char *)&apstk[cpu][0];
+	prptr->prsem = -1;
+	prptr->prparent = NULLPROC;
+	prptr->prhasmsg = FALSE;
+	for (i = 0; i < 3; i++) {
+		prptr->prdesc[i] = CONSOLE;
+	}
+	memset(prptr->freelists, 0, sizeof(prptr->freelists));
+	prptr->freemap = 0;
+	prptr->maxheap = KERNEL_END;
+	cpuclear(prptr);
+	prptr->prfpu = NULL;
+	prptr->prclass = PC_PRIO;
+	prptr->prbaseprio = prptr->prprio;
+	prptr->prmutex = prptr->prheld = -1;
+	prptr->prcpu = cpu;
+	prptr->prreq = 0;
+	cputab[cpu].cpidlepid = cputab[cpu].cpcurrpid = pid;
+	return pid;
+}
+
+/*------------------------------------------------------------------------
+ *  smpstart  -  Start one AP with INIT, then two STARTUP IPIs, and wait
+ *		   up to 100 ms for it to come up
+ *------------------------------------------------------------------------
+ */
+local	void	smpstart(
+	  int32		cpu		/* Index in cputab		*/
+	)
+{
+	struct	cpuent	*cpptr;		/* Ptr to the processor entry	*/
+	pid32	pid;			/* Its idle process		*/
+	int32	i;
+
+	cpptr = &cputab[cpu];
+	pid = smpidle(cpu);
+	if (pid == SYSERR) {
+		return;
+	}
+	*APFIELD(apstack) = (uint32)&apstk[cpu][APSTK / sizeof(uint32)];
+
+	lapic[LAPIC_ESR] = 0;
+	lapicipi(cpptr->cpapicid, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+	lapicipi(cpptr->cpapicid, ICR_INIT | ICR_LEVEL);
+	smpdelay(10000);
+	for (i = 0; i < 2; i++) {
+		lapicipi(cpptr->cpapicid, ICR_STARTUP | (APBOOT >> 12));
+		smpdelay(200);
+	}
+	for (i = 0; i < 1000 && cpptr->cpstate != CPU_ONLINE; i++) {
+		smpdelay(100);
+	}
+	if (cpptr->cpstate == CPU_ONLINE) {
+		ncpuonline++;
+	} else {
+		proctab[pid].prstate = PR_FREE;
+	}
+}
+
+#endif
+
+/*------------------------------------------------------------------------
+ *  smpinit  -  Find the processors and enable the local APIC of the BSP
+ *------------------------------------------------------------------------
+ */
+void	smpinit(void)
+{
+	uint32	bspid;			/* Local APIC ID of the BSP	*/
+	int32	i;
+
+	ncpus = 0;
+	lapic = ioapic = NULL;
+	lapicphys = ioapicphys = 0;
+	for (i = 0; i < NISAIRQ; i++) {
+		irqgsi[i] = i;		/* Unless the MADT says else	*/
+	}
+	if ((cpufeatures & CPUID_APIC) == 0
+	    || (smpacpi() == SYSERR && smpmp() == SYSERR)
+	    || ncpus == 0 || lapicphys < MMIO_PHYS
+	    || lapicphys >= MMIO_PHYS + MMIO_SIZE) {
+
+		/* No usable tables: run on the BSP behind the 8259	*/
+
+		ncpus = 1;
+		cputab[0].cpstate = CPU_ONLINE;
+		cputab[0].cpapicid = 0;
+		cputab[0].cpcr3 = KERNEL_PGDIR;
+		cputab[0].cpipis = 0;
+		ncpuonline = 1;
+		return;
+	}
+	smpmmio();
+
+	/* Make the processor running this code entry 0; only the	*/
+	/*   APIC IDs move, as each entry stays at its index		*/
+
+	bspid = lapic[LAPIC_ID] >> 24;
+	for (i = 0; i < ncpus && cputab[i].cpapicid != bspid; i++) {
+		;
+	}
+	if (i == ncpus) {
+		i = 0;			/* Not listed: trust the APIC	*/
+	}
+	cputab[i].cpapicid = cputab[0].cpapicid;
+	cputab[0].cpapicid = bspid;
+	cputab[0].cpstate = CPU_ONLINE;
+	ncpuonline = 1;
+
+	lapic[LAPIC_SVR] = SVR_ENABLE | IRQ_SPURIOUS;
+	set_evec(IRQ_IPI, (uint32)Xipi);
+	set_evec(IRQ_SPURIOUS, (uint32)Xspurious);
+}
+
+/*------------------------------------------------------------------------
+ *  smpboot  -  Start the application processors, once the local APIC
+ *		  timer gives the tick that each of them needs; only built
+ *		  with SMP (see compile/Makefile), they stay halted otherwise
+ *------------------------------------------------------------------------
+ */
+void	smpboot(void)			/* Assumes interrupts disabled	*/
+{
+#ifdef SMP
+	int32	i;
+#endif
+
+	if (ncpus < 2) {
+		return;
+	}
+#ifdef SMP
+	if (lapictimer != LT_NONE) {
+
+		/* APs enter protected mode with the GDT and paging of	*/
+		/*   the BSP, then load segment tables of their own	*/
+
+		memcpy((void *)APBOOT, apstart, apend - apstart);
+		asm volatile("sgdt %0" : "=m"(*APFIELD(apgdtr)));
+		*APFIELD(apcr3) = KERNEL_PGDIR;
+		asm volatile("movl %%cr4, %0" : "=r"(*APFIELD(apcr4)));
+		for (i = 1; i < ncpus; i++) {
+			smpstart(i);
+		}
+	}
+#endif
+	kprintf("%d of %d processors online\n", ncpuonline, ncpus);
+}
+
+/*------------------------------------------------------------------------
+ *  smpwhoami  -  Find the entry of the running processor by the ID of
+ *		    its local APIC, before its per-CPU segment is loaded
+ *------------------------------------------------------------------------
+ */
+local	int32	smpwhoami(void)
+{
+	uint32	id;			/* Local APIC ID		*/
+	int32	i;
+
+	id = lapic[LAPIC_ID] >> 24;
+	for (i = 1; i < ncpus; i++) {
+		if (cputab[i].cpapicid == id) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+/*------------------------------------------------------------------------
+ *  apmain  -  First C code of an application processor: load its own
+ *		 segment tables, start its clock tick and become the idle
+ *		 process that smpstart set up for it
+ *------------------------------------------------------------------------
+ */
+void	apmain(void)
+{
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+	int32	cpu;			/* Its index			*/
+
+	lidt();
+	cpu = smpwhoami();
+	setcpusegs(cpu);		/* currpid works from here on	*/
+	tssinit(cpu);
+	cpptr = &cputab[cpu];
+	lapic[LAPIC_SVR] = SVR_ENABLE | IRQ_SPURIOUS;
+	fpucpuinit();
+	fpuswitch(currpid);
+	lapicstart();
+	cpptr->cpcharged = cpustamp();
+	cpptr->cpcr3 = ReadCr3();
+	cpptr->cpstate = CPU_ONLINE;	/* Seen by smpstart	*/
+
+	/* Like the null process, run while nothing else is ready; the	*/
+	/*   kernel lock is only free once the BSP enables interrupts	*/
+
+	klockacquire();
+	while (TRUE) {
+		idlewait();
+		disable();
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  getcpu  -  Return the index in cputab of the running processor
+ *------------------------------------------------------------------------
+ */
+int32	getcpu(void)
+{
+	return cpuself()->cpindex;
+}
+
+/*------------------------------------------------------------------------
+ *  tlbflush  -  Flush the TLB of this processor if a shootdown asks for
+ *		   it and tell the sender; an idle processor still in a
+ *		   page directory being freed moves to the kernel's
+ *------------------------------------------------------------------------
+ */
+local	void	tlbflush(
+	  struct cpuent	*cpptr		/* Entry of this processor	*/
+	)
+{
+	uint32	cr3;			/* Reloading it flushes the TLB	*/
+	uint32	bit;			/* Its bit in tlbpending	*/
+
+	bit = 1 << cpptr->cpindex;
+	if (tlbpending & bit) {
+		if (tlbleave && cpptr->cpcr3 == tlbpgdir) {
+			cpptr->cpcr3 = KERNEL_PGDIR;
+			asm volatile("movl %0, %%cr3" : : "r"(KERNEL_PGDIR)
+					: "memory");
+		} else {
+			asm volatile("movl %%cr3, %0; movl %0, %%cr3"
+					: "=r"(cr3) : : "memory");
+		}
+		asm volatile("lock; andl %1, %0" : "+m"(tlbpending)
+				: "r"(~bit) : "memory");
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  klockacquire  -  Take the kernel lock (called by disable and the
+ *		     interrupt dispatchers), answering TLB shootdowns
+ *		     while it spins, as their IPIs cannot get through
+ *------------------------------------------------------------------------
+ */
+void	klockacquire(void)		/* Assumes interrupts disabled	*/
+{
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+
+	cpptr = cpuself();
+	while (!spintry(&klock)) {
+		while (klock.sllocked) {
+			tlbflush(cpptr);
+			asm volatile("pause");
+		}
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  klockrelease  -  Release the kernel lock
+ *------------------------------------------------------------------------
+ */
+void	klockrelease(void)		/* Assumes interrupts disabled	*/
+{
+	spinrelease(&klock);
+}
+
+/*------------------------------------------------------------------------
+ *  cpuipi  -  Ask another processor for IPI_ work with an IPI
+ *------------------------------------------------------------------------
+ */
+void	cpuipi(				/* Assumes interrupts disabled	*/
+	  int32		cpu,		/* Index of the processor	*/
+	  uint32	work		/* IPI_RESCHED and/or IPI_REQUEST*/
+	)
+{
+	struct	cpuent	*cpptr;		/* Ptr to the processor entry	*/
+
+	cpptr = &cputab[cpu];
+	asm volatile("lock; orl %1, %0" : "+m"(cpptr->cpipiwork)
+			: "r"(work) : "memory");
+	lapicipi(cpptr->cpapicid, ICR_FIXED | IRQ_IPI);
+}
+
+/*------------------------------------------------------------------------
+ *  cpurequest  -  Kill or suspend a process as another processor asked
+ *		   while the process ran here
+ *------------------------------------------------------------------------
+ */
+void	cpurequest(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of the process		*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process table entry	*/
+	uint32	req;			/* PRQ_ bits asked of it	*/
+
+	prptr = &proctab[pid];
+	req = prptr->prreq;
+	prptr->prreq = 0;
+	if (req & PRQ_KILL) {
+		kill(pid);
+	} else if (req & PRQ_SUSP) {
+		suspend(pid);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  ipihandler  -  Handle an interprocessor interrupt (called by Xipi):
+ *		   a TLB shootdown needs no lock, other work takes the
+ *		   kernel lock
+ *------------------------------------------------------------------------
+ */
+void	ipihandler(void)
+{
+	struct	cpuent	*cpptr;		/* Entry of this processor	*/
+	uint32	work;			/* IPI_ work asked of it	*/
+	pid32	pid;
+
+	cpptr = cpuself();
+	cpptr->cpipis++;
+	tlbflush(cpptr);
+	lapic[LAPIC_EOI] = 0;
+	if (cpptr->cpipiwork == 0) {
+		return;
+	}
+	klockacquire();
+	work = 0;
+	asm volatile("xchgl %0, %1" : "+r"(work), "+m"(cpptr->cpipiwork)
+			: : "memory");
+
+	/* A process asked for may have stopped running meanwhile, and	*/
+	/*   it is then handled here; one still running on another	*/
+	/*   processor is handled there, the current process last	*/
+
+	if (work & IPI_REQUEST) {
+		for (pid = 0; pid < NPROC; pid++) {
+			if (proctab[pid].prreq != 0 && pid != currpid
+			    && proctab[pid].prstate != PR_CURR) {
+				cpurequest(pid);
+			}
+		}
+		if (proctab[currpid].prreq != 0) {
+			cpurequest(currpid);
+		}
+	}
+	if (work & IPI_RESCHED) {
+		resched();
+	}
+	klockrelease();
+}
+
+/*------------------------------------------------------------------------
+ *  tlbsend  -  Make the other processors running in page directory
+ *		  pgdir flush their TLBs, and wait until they have; the
+ *		  kernel lock keeps it to one shootdown at a time
+ *------------------------------------------------------------------------
+ */
+local	void	tlbsend(		/* Assumes interrupts disabled	*/
+	  uint32	pgdir,		/* Page directory that changed	*/
+	  bool8		leave		/* Idle borrowers must leave it	*/
+	)
+{
+	struct	cpuent	*self;		/* Entry of this processor	*/
+	uint32	targets;		/* Processors to interrupt	*/
+	int32	i;
+
+	if (ncpuonline < 2) {
+		return;
+	}
+	self = cpuself();
+	targets = 0;
+	for (i = 0; i < ncpus; i++) {
+		if (&cputab[i] != self && cputab[i].cpstate == CPU_ONLINE
+		    && cputab[i].cpcr3 == pgdir) {
+			targets |= 1 << i;
+		}
+	}
+	if (targets == 0) {
+		return;
+	}
+	tlbpgdir = pgdir;
+	tlbleave = leave;
+	tlbpending = targets;
+	for (i = 0; i < ncpus; i++) {
+		if (targets & (1 << i)) {
+			lapicipi(cputab[i].cpapicid, ICR_FIXED | IRQ_IPI);
+		}
+	}
+	while (tlbpending != 0) {
+		asm volatile("pause");
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  tlbshootdown  -  Make the other processors running in page directory
+ *		       pgdir flush their TLBs
+ *------------------------------------------------------------------------
+ */
+void	tlbshootdown(			/* Assumes interrupts disabled	*/
+	  uint32	pgdir		/* Page directory that changed	*/
+	)
+{
+	tlbsend(pgdir, FALSE);
+}
+
+/*------------------------------------------------------------------------
+ *  tlbevict  -  Move the idle processors that borrow page directory
+ *		   pgdir, about to be freed, to the kernel page directory
+ *------------------------------------------------------------------------
+ */
+void	tlbevict(			/* Assumes interrupts disabled	*/
+	  uint32	pgdir		/* Page directory being freed	*/
+	)
+{
+	tlbsend(pgdir, TRUE);
+}
@@ -15,7 +15,7 @@ syscall	suspend(
 	pri16	prio;			/* Priority to return		*/
 
 	mask = disable();
-	if (isbadpid(pid) || (pid == NULLPROC)) {
+	if (isbadpid(pid) || isidlepid(pid)) {
 		restore(mask);
 		return SYSERR;
 	}
@@ -27,8 +27,18 @@ syscall	suspend(
 		restore(mask);
 		return SYSERR;
 	}
+
+	/* A process running on another processor is suspended there	*/
+
+	if (prptr->prstate == PR_CURR && pid != currpid) {
+		prptr->prreq |= PRQ_SUSP;
+		cpuipi(prptr->prcpu, IPI_REQUEST);
+		prio = prptr->prprio;
+		restore(mask);
+		return prio;
+	}
 	if (prptr->prstate == PR_READY) {
-		getitem(pid);		    /* Remove a ready process	*/
+		readyremove(pid);	    /* Remove a ready process	*/
 					    /*   from the ready list	*/
 		prptr->prstate = PR_SUSP;
 	} else {
@@ -0,0 +1,169 @@
+/* tsc.c - tscinit, tscsync, getcycles, getnanos, udiv64 */
+
+#include <xinu.h>
+
+#define	TSC_SHIFT	24		/* Fraction bits of tscmult	*/
+#define	TSC_CALCOUNT	11932		/* Calibration: 10 ms of counts	*/
+#define	TSC_MAXSLEW	500		/* Most correction, in ppm	*/
+#define	NSEC_PER_SEC	1000000000
+
+#define	PORTB		0x61		/* Keyboard controller port B	*/
+#define	PORTB_GATE2	0x01		/*   gate of counter 2		*/
+#define	PORTB_SPKR	0x02		/*   speaker data		*/
+#define	PORTB_OUT2	0x20		/*   output of counter 2	*/
+#define	CLOCK2		(CLOCKBASE+2)	/* Counter 2 of the clock chip	*/
+
+uint32	tschz;			/* TSC cycles per second, 0 if no TSC	*/
+local	uint32	tscnominal;	/* ns per cycle << TSC_SHIFT		*/
+local	uint32	tscmult;	/* tscnominal with the drift correction	*/
+local	uint64	tscbase;	/* Cycle count at the last sync		*/
+local	uint64	tscbasens;	/* Nanoseconds since boot at that point	*/
+
+/*------------------------------------------------------------------------
+ *  udiv64  -  Divide a 64-bit number by a 32-bit one (no libgcc here)
+ *------------------------------------------------------------------------
+ */
+uint64	udiv64(
+	  uint64	n,		/* Dividend			*/
+	  uint32	d,		/* Divisor			*/
+	  uint32	*rem		/* Remainder, or NULL		*/
+	)
+{
+	uint32	hi, lo;			/* Halves of the dividend	*/
+	uint32	qhi, qlo, r;		/* Quotient halves, remainder	*/
+
+	hi = (uint32)(n >> 32);
+	lo = (uint32)n;
+	qhi = hi / d;
+	hi %= d;
+	asm("divl %4" : "=a"(qlo), "=d"(r) : "a"(lo), "d"(hi), "rm"(d));
+	if (rem != NULL) {
+		*rem = r;
+	}
+	return ((uint64)qhi << 32) | qlo;
+}
+
+/*------------------------------------------------------------------------
+ *  cyc2ns  -  Nanoseconds since boot at cycle count cycles
+ *------------------------------------------------------------------------
+ */
+local	uint64	cyc2ns(
+	  uint64	cycles		/* Cycle count at or after base	*/
+	)
+{
+	uint64	delta;			/* Cycles since the last sync	*/
+
+	delta = cycles - tscbase;
+	return tscbasens
+		+ (((uint64)(uint32)(delta >> 32) * tscmult) << (32 - TSC_SHIFT))
+		+ (((uint64)(uint32)delta * tscmult) >> TSC_SHIFT);
+}
+
+/*------------------------------------------------------------------------
+ *  tscinit  -  Measure the TSC rate against counter 2 of the clock chip
+ *------------------------------------------------------------------------
+ */
+void	tscinit(void)
+{
+	uint64	start;			/* Cycle count at the start	*/
+	uint32	cycles;			/* Cycles in TSC_CALCOUNT counts*/
+	int32	portb;			/* Saved port B contents	*/
+
+	tschz = 0;
+	if (!(cpufeatures & CPUID_TSC)) {
+		return;
+	}
+
+	/* Run counter 2 once through TSC_CALCOUNT counts with the	*/
+	/*   speaker off, and count the cycles until its output rises	*/
+
+	portb = inb(PORTB);
+	outb(PORTB, (portb & ~PORTB_SPKR) | PORTB_GATE2);
+	outb(CLKCNTL, 0xb0);		/* Counter 2, mode 0		*/
+	outb(CLOCK2, (char) (0xff & TSC_CALCOUNT));
+	outb(CLOCK2, (char) (0xff & (TSC_CALCOUNT >> 8)));
+	start = getcycles();
+	while (!(inb(PORTB) & PORTB_OUT2)) {
+		;
+	}
+	cycles = (uint32)(getcycles() - start);
+	outb(PORTB, portb);
+
+	/* The chip runs at 1193182 Hz */
+
+	tschz = (uint32)udiv64((uint64)cycles * 1193182, TSC_CALCOUNT, NULL);
+	if (tschz == 0) {
+		return;
+	}
+	tscnominal = (uint32)udiv64((uint64)NSEC_PER_SEC << TSC_SHIFT,
+				tschz, NULL);
+	tscmult = tscnominal;
+	tscbase = getcycles();
+	tscbasens = 0;
+}
+
+/*------------------------------------------------------------------------
+ *  tscsync  -  Called on each second boundary of the clock to slew
+ *		the TSC scale toward the clock, keeping time monotonic
+ *------------------------------------------------------------------------
+ */
+void	tscsync(void)			/* Assumes interrupts disabled	*/
+{
+	uint64	now;			/* Current cycle count		*/
+	uint64	ns;			/* TSC time now			*/
+	uint64	ref;			/* Clock time now		*/
+	uint64	err;			/* |ref - ns| in ns		*/
+	uint32	adj;			/* Change of tscmult		*/
+
+	if (tschz == 0) {
+		return;
+	}
+	now = getcycles();
+	ns = cyc2ns(now);
+	ref = (uint64)clktime * NSEC_PER_SEC;
+
+	/* Continue from the current TSC time and make up the error	*/
+	/*   over the next second, by at most TSC_MAXSLEW ppm		*/
+
+	tscbase = now;
+	tscbasens = ns;
+	err = ref > ns ? ref - ns : ns - ref;
+	if (err > TSC_MAXSLEW * 1000) {
+		err = TSC_MAXSLEW * 1000;
+	}
+	adj = (uint32)udiv64((uint64)tscnominal * err, NSEC_PER_SEC, NULL);
+	tscmult = ref > ns ? tscnominal + adj : tscnominal - adj;
+}
+
+/*------------------------------------------------------------------------
+ *  getcycles  -  Read the time stamp counter
+ *------------------------------------------------------------------------
+ */
+uint64	getcycles(void)
+{
+	uint64	ret;
+
+	asm volatile ("rdtsc" : "=A"(ret));
+	return ret;
+}
+
+/*------------------------------------------------------------------------
+ *  getnanos  -  Monotonic nanoseconds since boot, from the TSC when
+ *		 there is one and from the clock tick otherwise
+ *------------------------------------------------------------------------
+ */
+uint64	getnanos(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	uint64	ns;			/* Time to return		*/
+
+	mask = disable();
+	if (tschz != 0) {
+		ns = cyc2ns(getcycles());
+	} else {
+		ns = (uint64)clktime * NSEC_PER_SEC
+			+ (uint64)count1000 * (NSEC_PER_SEC / 1000);
+	}
+	restore(mask);
+	return ns;
+}
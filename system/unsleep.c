@@ -18,6 +18,7 @@ status	unsleep(
         pid32	pidnext;		/* ID of process on sleep queue	*/
 					/*   that follows the process	*/
 					/*   which is being removed	*/
+	uint64	start;			/* Cycle counter at the start	*/
 
 	mask = disable();
 
@@ -34,14 +35,20 @@ status	unsleep(
 		return SYSERR;
 	}
 
-	/* Increment delay of next process if such a process exists */
+	/* On the delta list, increment delay of next process if such	*/
+	/*   a process exists; wheel queues hold absolute ticks		*/
 
-	pidnext = queuetab[pid].qnext;
-	if (pidnext < NPROC) {
-		queuetab[pidnext].qkey += queuetab[pid].qkey;
+	start = getticks();
+	if (sleepkind == SLP_DELTA) {
+		pidnext = queuetab[pid].qnext;
+		if (pidnext < NPROC) {
+			queuetab[pidnext].qkey += queuetab[pid].qkey;
+		}
 	}
 
 	getitem(pid);			/* Unlink process from queue */
+	sleepopcyc += (uint32)(getticks() - start);
+	sleepops++;
 	restore(mask);
 	return OK;
 }
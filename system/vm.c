@@ -3,14 +3,18 @@
 #include <xinu.h>
 
 uint32 is_page;
+uint32 vm_pse;
+uint32 vm_pge;
+uint32 pgfaults;
+uint32 cowcopies;
+uint32 heaptrims;
 
-extern uint32 free_pages;
-extern uint32 *ptpt;
-extern uint32 total_pages;
-extern uint32 phypagemax;
-
-
+static struct spinlock frlock; // frame allocator, shared by all processors; taken with spindisable, not the kernel lock
 
+/*
+ * Drop the TLB entry of page here and on the other processors running in
+ * the same address space
+ */
 void FlushTlb(void *page)
 {
     asm volatile(
@@ -18,13 +22,98 @@ void FlushTlb(void *page)
         :
         : "r"(page)
         : "memory");
+    tlbshootdown(ReadCr3());
 }
-inline void MkpgAccessibleby0x1fff000(uint32 paddr)
+
+uint32 ReadCr3(void)
 {
-    intmask mask = disable();
-    ((struct page *)(KERNEL_END - 2 * PAGE_SIZE))->entries[1023] = paddr | PTE_P | PTE_W; // now we hope that pddr's physical page can be accessed by 0x1fff000
-    FlushTlb((struct page *)0x1fff000);
-    restore(mask);
+    uint32 val;
+    asm volatile(
+        "movl %%cr3, %0\n\t"
+        : "=r"(val));
+    return val;
+}
+
+uint32 ReadCr2(void)
+{
+    uint32 val;
+    asm volatile(
+        "movl %%cr2, %0\n\t"
+        : "=r"(val));
+    return val;
+}
+
+/*
+ * Translate vaddr in the address space of page directory pgdir to its
+ * physical address, SYSERR if it is not mapped
+ */
+uint32 VirtToPhys(uint32 pgdir, uint32 vaddr)
+{
+    struct page *dir = (struct page *)phys_to_virt(pgdir);
+    struct page *tbl;
+    uint32 pde = dir->entries[(vaddr >> 22) & 0x3ff];
+    if (!(pde & PTE_P))
+    {
+        return SYSERR;
+    }
+    if (pde & PTE_PS)
+    {
+        return (pde & 0xffc00000) | (vaddr & 0x3fffff);
+    }
+    tbl = (struct page *)phys_to_virt(pde & ~0xfff);
+    if (!(tbl->entries[(vaddr >> 12) & 0x3ff] & PTE_P))
+    {
+        return SYSERR;
+    }
+    return (tbl->entries[(vaddr >> 12) & 0x3ff] & ~0xfff) | (vaddr & 0xfff);
+}
+
+/*
+ * Page table entry mapping vaddr in page directory pgdir, NULL if there is no
+ * page table for it (or it lies in a 4 MB page)
+ */
+static uint32 *PtePtr(uint32 pgdir, uint32 vaddr)
+{
+    struct page *dir = (struct page *)phys_to_virt(pgdir);
+    uint32 pde = dir->entries[(vaddr >> 22) & 0x3ff];
+    if (!(pde & PTE_P) || (pde & PTE_PS))
+    {
+        return NULL;
+    }
+    return &((struct page *)phys_to_virt(pde & ~0xfff))->entries[(vaddr >> 12) & 0x3ff];
+}
+
+/*
+ * Copy nbytes from src to vaddr in the address space of page directory
+ * pgdir, going through the direct map one page at a time. Pages not backed
+ * yet or shared copy-on-write are handled here as a fault would, so vaddr
+ * must lie in a range the owner of pgdir has reserved.
+ */
+status CopyToVirt(uint32 pgdir, uint32 vaddr, void *src, uint32 nbytes)
+{
+    uint32 paddr, chunk;
+    while (nbytes > 0)
+    {
+        paddr = MapZeroPage(pgdir, vaddr);
+        if (paddr != SYSERR)
+        { // a shared page would fault on a normal write too
+            paddr = CopyOnWrite(pgdir, vaddr);
+        }
+        if (paddr == SYSERR)
+        {
+            return SYSERR;
+        }
+        chunk = PAGE_SIZE - (vaddr & 0xfff);
+        if (chunk > nbytes)
+        {
+            chunk = nbytes;
+        }
+        memcpy(phys_to_virt(paddr), src, chunk);
+        vaddr += chunk;
+        src = (char *)src + chunk;
+        nbytes -= chunk;
+    }
+    return OK;
 }
 
 
@@ -48,59 +137,333 @@ uint32 Pages2Tbls(uint32 npages)
     return result;
 }
 
-struct page *GetOnePage(void)
+int32 frfree[FR_MAXORDER + 1];   /* Heads of the per-order free lists */
+uint32 frnfree[FR_MAXORDER + 1]; /* Free blocks of each order */
+
+/*
+ * Map a physical frame to its entry in frtab, SYSERR if the frame is not
+ * managed by the allocator. The region table is tiny, so this is O(1).
+ */
+int32 FrameIndex(uint32 paddr)
 {
-    intmask mask = disable();
+    struct frregion *frptr;
     int i;
-    uint32 phy_addr;
-    for (i = total_pages; i > 0; i--)
+    for (i = 0; i < nfrregions; i++)
     {
-        phy_addr = *(ptpt - i);
-        if ((phy_addr & 1) == 0)
+        frptr = &frregions[i];
+        if (paddr >= frptr->fr_base && (paddr - frptr->fr_base) / PAGE_SIZE < frptr->fr_npages)
         {
-            *(ptpt - i) = phy_addr | 1;
+            return frptr->fr_index + (paddr - frptr->fr_base) / PAGE_SIZE;
+        }
+    }
+    return SYSERR;
+}
+
+/*
+ * Find the region holding the frame with the given frtab index
+ */
+static struct frregion *IndexRegion(int32 index)
+{
+    int i;
+    for (i = nfrregions - 1; i > 0; i--)
+    {
+        if (index >= frregions[i].fr_index)
+        {
+            break;
+        }
+    }
+    return &frregions[i];
+}
+
+/*
+ * Physical address of the frame with the given frtab index
+ */
+static uint32 IndexAddr(int32 index)
+{
+    struct frregion *frptr = IndexRegion(index);
+    return frptr->fr_base + (index - frptr->fr_index) * PAGE_SIZE;
+}
+
+/*
+ * Smallest order whose block holds npages frames
+ */
+uint32 Pages2Order(uint32 npages)
+{
+    uint32 order = 0;
+    while ((1 << order) < npages)
+    {
+        order++;
+    }
+    return order;
+}
+
+static void FreeListAdd(int32 index, uint32 order)
+{
+    struct frentry *feptr = &frtab[index];
+    feptr->fe_state = FR_FREE;
+    feptr->fe_order = order;
+    feptr->fe_prev = EMPTY;
+    feptr->fe_next = frfree[order];
+    if (frfree[order] != EMPTY)
+    {
+        frtab[frfree[order]].fe_prev = index;
+    }
+    frfree[order] = index;
+    frnfree[order]++;
+}
+
+static void FreeListDel(int32 index)
+{
+    struct frentry *feptr = &frtab[index];
+    if (feptr->fe_prev != EMPTY)
+    {
+        frtab[feptr->fe_prev].fe_next = feptr->fe_next;
+    }
+    else
+    {
+        frfree[feptr->fe_order] = feptr->fe_next;
+    }
+    if (feptr->fe_next != EMPTY)
+    {
+        frtab[feptr->fe_next].fe_prev = feptr->fe_prev;
+    }
+    frnfree[feptr->fe_order]--;
+}
+
+/*
+ * Take a block of 2^order frames off the free lists, splitting a larger
+ * block if needed. Every frame of the block is marked used on its own, so
+ * the frames may later be freed one at a time.
+ */
+static int32 TakeBlock(uint32 order)
+{
+    intmask mask;
+    uint32 k;
+    int32 index;
+    int i;
+    mask = spindisable(&frlock);
+    for (k = order; k <= FR_MAXORDER && frfree[k] == EMPTY; k++)
+        ;
+    if (k > FR_MAXORDER)
+    {
+        spinrestore(&frlock, mask);
+        return SYSERR;
+    }
+    index = frfree[k];
+    FreeListDel(index);
+    while (k > order)
+    { // give the upper half back at the next lower order
+        k--;
+        FreeListAdd(index + (1 << k), k);
+    }
+    for (i = 0; i < (1 << order); i++)
+    {
+        frtab[index + i].fe_state = FR_USED;
+        frtab[index + i].fe_refs = 1;
+    }
+    free_pages -= 1 << order;
+    spinrestore(&frlock, mask);
+    return index;
+}
+
+/*
+ * Zero npages frames starting at physical address paddr
+ */
+static void ZeroPages(uint32 paddr, uint32 npages)
+{
+    memset(is_page ? phys_to_virt(paddr) : (void *)paddr, 0, npages * PAGE_SIZE);
+}
+
+/*
+ * Allocate 2^order physically contiguous, zeroed frames (NULL if none)
+ */
+struct page *GetPages(uint32 order)
+{
+    int32 index;
+    uint32 phy_addr;
+    if (order > FR_MAXORDER)
+    {
+        return NULL;
+    }
+    index = TakeBlock(order);
+    if (index == SYSERR && cache_reclaim() > 0)
+    { // memory pressure: empty slabs give their pages back first
+        index = TakeBlock(order);
+    }
+    if (index == SYSERR)
+    {
+        return NULL;
+    }
+    phy_addr = IndexAddr(index);
 #ifdef DEBUG_INFO
-            kprintf("[I](GetOnePage) get page's physical address: 0x%x\n", (uint32)phy_addr);
+    kprintf("[I](GetPages) get %d page(s) at physical address: 0x%x\n", 1 << order, phy_addr);
 #endif
-            if (is_page)
-            {
-                MkpgAccessibleby0x1fff000(phy_addr);
-                memset((void *)0x1fff000, 0, PAGE_SIZE);
-            }
-            else
-            {
-                memset((void *)phy_addr, 0, PAGE_SIZE);
-            }
-            restore(mask);
-            return (void *)phy_addr;
-        }
+    ZeroPages(phy_addr, 1 << order);
+    return (struct page *)phy_addr;
+}
+
+/*
+ * Allocate npages physically contiguous, zeroed frames (NULL if none).
+ * The frames past npages in the underlying buddy block are freed again.
+ */
+struct page *GetPagesN(uint32 npages)
+{
+    uint32 order = Pages2Order(npages);
+    int32 index;
+    uint32 phy_addr;
+    int i;
+    if (npages == 0 || order > FR_MAXORDER)
+    {
+        return NULL;
     }
-    restore(mask);
-    panic("Out of memory");
-    return NULL;
+    index = TakeBlock(order);
+    if (index == SYSERR && cache_reclaim() > 0)
+    { // memory pressure: empty slabs give their pages back first
+        index = TakeBlock(order);
+    }
+    if (index == SYSERR)
+    {
+        return NULL;
+    }
+    phy_addr = IndexAddr(index);
+    for (i = npages; i < (1 << order); i++)
+    {
+        FreePages((struct page *)(phy_addr + i * PAGE_SIZE), 0);
+    }
+    ZeroPages(phy_addr, npages);
+    return (struct page *)phy_addr;
 }
 
-void FreeOnePage(struct page *addr)
+/*
+ * Return 2^order frames starting at addr and coalesce them with their
+ * free buddies
+ */
+void FreePages(struct page *addr, uint32 order)
 {
-    if ((uint32)addr < 1024 * 1024 * 32)
+    intmask mask;
+    int32 index;
+    struct frregion *frptr;
+    struct frentry *buddy;
+    uint32 basepfn, offset, boff;
+    int i;
+    if ((uint32)addr < KERNEL_END)
     {
-        kprintf("[E](FreeOnePage) attempts to free a kernel page %x\n", addr);
+        kprintf("[E](FreePages) attempts to free a kernel page %x\n", addr);
         return;
     }
 
     if ((uint32)addr & 0xfff)
     {
-        kprintf("[W](FreeOnePage) page address try to free: last 12 bits is not zero\n");
+        kprintf("[W](FreePages) page address try to free: last 12 bits is not zero\n");
         addr = (struct page *)((uint32)addr & ~0xfff);
     }
-    uint32 index = (phypagemax - (uint32)addr) / PAGE_SIZE;
-    uint32 *PhysicalPagesPoolBase = ptpt - total_pages;
-    PhysicalPagesPoolBase[index] &= ~1;
+    mask = spindisable(&frlock);
+    index = FrameIndex((uint32)addr);
+    if (index == SYSERR || order > FR_MAXORDER)
+    { // report with the lock released, as kprintf takes the kernel lock
+        spinrestore(&frlock, mask);
+        kprintf("[E](FreePages) 0x%x (order %d) is not a managed block\n", addr, order);
+        return;
+    }
+    frptr = IndexRegion(index);
+    basepfn = frptr->fr_base / PAGE_SIZE;
+    offset = index - frptr->fr_index;
+    if (((basepfn + offset) & ((1 << order) - 1)) || offset + (1 << order) > frptr->fr_npages)
+    {
+        spinrestore(&frlock, mask);
+        kprintf("[E](FreePages) 0x%x is not aligned to order %d\n", addr, order);
+        return;
+    }
+    for (i = 0; i < (1 << order); i++)
+    {
+        if (!FrameInUse(index + i))
+        {
+            spinrestore(&frlock, mask);
+            kprintf("[W](FreePages) 0x%x is already free\n", (uint32)addr + i * PAGE_SIZE);
+            return;
+        }
+    }
+    for (i = 0; i < (1 << order); i++)
+    {
+        frtab[index + i].fe_state = FR_INNER;
+    }
+    free_pages += 1 << order;
+
+    /* Merge with the buddy while it heads a free block of equal order */
+    while (order < FR_MAXORDER)
+    {
+        boff = ((basepfn + offset) ^ (1 << order)) - basepfn;
+        if (boff >= frptr->fr_npages || boff + (1 << order) > frptr->fr_npages)
+        { // buddy lies (partly) outside the region
+            break;
+        }
+        buddy = &frtab[frptr->fr_index + boff];
+        if (buddy->fe_state != FR_FREE || buddy->fe_order != order)
+        {
+            break;
+        }
+        FreeListDel(frptr->fr_index + boff);
+        buddy->fe_state = FR_INNER;
+        if (boff < offset)
+        {
+            offset = boff;
+        }
+        order++;
+    }
+    FreeListAdd(frptr->fr_index + offset, order);
+    spinrestore(&frlock, mask);
 #ifdef DEBUG_INFO
-    kprintf("[I](FreeOnePage) free 0x%x succeed\n", addr);
+    kprintf("[I](FreePages) free 0x%x succeed\n", addr);
 #endif
 }
 
+struct page *GetOnePage(void)
+{
+    struct page *pg = GetPages(0);
+    if (pg == NULL)
+    {
+        panic("Out of memory");
+    }
+    return pg;
+}
+
+void FreeOnePage(struct page *addr)
+{
+    FreePages(addr, 0);
+}
+
+/*
+ * One more page table maps the frame at paddr
+ */
+void ShareFrame(uint32 paddr)
+{
+    intmask mask;
+    int32 index = FrameIndex(paddr);
+    if (index != SYSERR)
+    {
+        mask = spindisable(&frlock);
+        frtab[index].fe_refs++;
+        spinrestore(&frlock, mask);
+    }
+}
+
+/*
+ * One page table less maps the frame at paddr; free it with the last one
+ */
+void PutFrame(uint32 paddr)
+{
+    int32 index = FrameIndex(paddr);
+    intmask mask = spindisable(&frlock);
+    if (index != SYSERR && frtab[index].fe_refs > 1)
+    {
+        frtab[index].fe_refs--;
+        spinrestore(&frlock, mask);
+        return;
+    }
+    spinrestore(&frlock, mask);
+    FreeOnePage((struct page *)paddr);
+}
+
 /*
  * Set boundary tag for allocated blocks
  */
@@ -120,204 +483,196 @@ void set_free_boundary_tag(uint32 *ptr, uint32 size)
 }
 
 /*
- * Insert new free block into the free list
+ * Size class of a block of size bytes: one class per size up to
+ * HEAP_SMALLMAX, then one per power of two
  */
-void insert_free_block(uint32 *ptr)
+static uint32 HeapClass(uint32 size)
 {
-    uint32 *first = (uint32 *)proctab[currpid].freelistptr;
-    if (!first)
-    { // empty free list
-        *first = (uint32)ptr;
-        proctab[currpid].freelistptr = (uint32)ptr;
-        *ptr = (uint32)ptr;
-        *(ptr + 1) = (uint32)ptr;
-        return;
+    uint32 c;
+    if (size <= HEAP_SMALLMAX)
+    {
+        return size / ALIGNMENT - HEAP_MINBLK / ALIGNMENT;
     }
-    uint32 *next = (uint32 *)*first;
+    c = HEAP_NSMALL + HighBit(size) - HighBit(HEAP_SMALLMAX); // (HEAP_SMALLMAX, 2 * HEAP_SMALLMAX) is the first
+    return c < HEAP_NCLASS ? c : HEAP_NCLASS - 1;
+}
 
-    uint32 *block_before = (uint32 *)*(next + 1);
-    *(next + 1) = (uint32)ptr;
-    *block_before = (uint32)ptr;
-    *ptr = (uint32)next;
-    *(ptr + 1) = (uint32)block_before;
+/*
+ * Insert new free block at the head of its size class list
+ */
+void insert_free_block(uint32 *ptr)
+{
+    uint32 *heads = proctab[currpid].freelists;
+    uint32 c = HeapClass(*(ptr - 1) & ~3);
+    *ptr = heads[c];
+    *(ptr + 1) = 0;
+    if (heads[c])
+    {
+        *((uint32 *)heads[c] + 1) = (uint32)ptr;
+    }
+    heads[c] = (uint32)ptr;
+    proctab[currpid].freemap |= 1 << c;
 }
 
 /*
- * Delete a freeblock from the free list.
+ * Delete a free block from its size class list
  */
 void delete_free_block(uint32 *ptr)
 {
-    uint32 *after = (uint32 *)*ptr;
-    uint32 *first = (uint32 *)proctab[currpid].freelistptr;
-    if (after == ptr)
-    { // The free list contains a free block only
-        *first = 0;
-        proctab[currpid].freelistptr = NULL;
-        return;
+    uint32 *heads = proctab[currpid].freelists;
+    uint32 next = *ptr;
+    uint32 prev = *(ptr + 1);
+    uint32 c;
+    if (prev)
+    {
+        *(uint32 *)prev = next;
     }
-    uint32 *before = (uint32 *)*(ptr + 1);
-    *(after + 1) = (uint32)before;
-    *before = (uint32)after;
-    if (*first == (uint32)ptr)
-    { // If the guard points to the block to be deleted, then change the guard.
-        *first = (uint32)after;
-        proctab[currpid].freelistptr = *first;
+    else
+    {
+        c = HeapClass(*(ptr - 1) & ~3);
+        heads[c] = next;
+        if (!next)
+        {
+            proctab[currpid].freemap &= ~(1 << c);
+        }
+    }
+    if (next)
+    {
+        *((uint32 *)next + 1) = prev;
     }
 }
 
 /*
- * Assign the old free block to the new and set the size
+ * Mark the free block ptr of size bytes allocated with newsize bytes, giving
+ * the tail back to the free lists when it can hold a block of its own
  */
-void assign_free_block(uint32 *old, uint32 *new, uint32 newsize)
-{
-    uint32 *first = (uint32 *)proctab[currpid].freelistptr;
-    set_free_boundary_tag(new, newsize);
-    FlushTlb((void *)old);
-    if (*old == (uint32)old)
-    { // The freelist contains one free block only
-        *first = (uint32) new;
-        proctab[currpid].freelistptr = *first;
-        *(new + 1) = (uint32) new;
-        *new = (uint32) new;
-        return;
+static uint32 *place_block(uint32 *ptr, uint32 size, uint32 newsize)
+{
+    uint32 hole = *(ptr - 1) & HEAP_HOLE;
+    if (size - newsize >= HEAP_MINBLK)
+    {
+        set_alloc_boundary_tag(ptr, newsize);
+        set_free_boundary_tag(ptr + newsize / 4, size - newsize);
+        *(ptr + newsize / 4 - 1) |= hole; // the tail keeps whatever pages are still unbacked
+        insert_free_block(ptr + newsize / 4);
     }
-    uint32 *prev = (uint32 *)*(old + 1);
-    uint32 *next = (uint32 *)*old;
-    *prev = (uint32) new;
-    *(next + 1) = (uint32) new;
-    *new = (uint32)next;
-    *(new + 1) = (uint32)prev;
-
+    else
+    {
+        set_alloc_boundary_tag(ptr, size);
+    }
+    return ptr;
 }
 
 /*
- * Scan in the free list to find the free block BEST for newsize.
- * Return a pointer to a block with allocated boundary tag set.(Return 0 if no block is found)
- * The free list changes accordingly.
+ * Find a free block for newsize bytes, take it off its list and return it with
+ * allocated boundary tags set (0 if there is none). A small request is served
+ * by the head of its exact class; a large one first scans its own class, whose
+ * blocks differ in size. Otherwise the head of the smallest non-empty larger
+ * class, found with one bsf on freemap, fits and is split.
  */
 uint32 *scan_free_block(uint32 newsize)
 {
-    uint32 *first = (uint32 *)proctab[currpid].freelistptr;
-    uint32 *current = (uint32 *)*first;
-    if (!current)
-    { // empty free list, MAYBE this won't happen, before scan, we make sure first points to a free block
-        return 0;
-    }
-    uint32 min_quan = ~0;
-    uint32 *bestfit = NULL;
-    int fit_flag = 0;
-    while (1)
+    uint32 *heads = proctab[currpid].freelists;
+    uint32 c = HeapClass(newsize);
+    uint32 *current = (uint32 *)heads[c];
+    uint32 larger;
+    if (c >= HEAP_NSMALL)
     {
-        uint32 free_size = *(current - 1);
-        if (newsize <= free_size - 16)
+        while (current && (*(current - 1) & ~3) < newsize)
         {
-            if (min_quan > free_size - newsize)
-            {
-                fit_flag = 1;
-                min_quan = free_size - newsize;
-                bestfit = current;
-            }
-        }
-        if (newsize <= free_size && newsize > free_size - 16)
-        {
-            set_alloc_boundary_tag(current, free_size);
-            delete_free_block(current);
-            return current;
-        }
-
-        current = (uint32 *)*current; // go to next free block
-        if (*first == (uint32)current)
-        {
-            break;
-            // return 0;
+            current = (uint32 *)*current;
         }
     }
-    if (!fit_flag)
+    if (!current)
     {
-        return NULL;
+        larger = c + 1 < HEAP_NCLASS ? proctab[currpid].freemap & ~((2 << c) - 1) : 0;
+        if (!larger)
+        {
+            return 0;
+        }
+        current = (uint32 *)heads[LowBit(larger)];
     }
-
-    uint32 free_size = *(bestfit - 1);
-    uint32 left = free_size - newsize;
-    set_alloc_boundary_tag(bestfit, newsize);
-    assign_free_block(bestfit, bestfit + newsize / 4, left);
-    return bestfit;
+    delete_free_block(current);
+    return place_block(current, *(current - 1) & ~3, newsize);
 }
 
-uint32 heapsbrk(uint32 nbytes) // please notice, this function will get some pages
+uint32 heapsbrk(uint32 nbytes) // only reserves the pages, PageFault backs each one on its first touch
 {
 #ifdef DEBUG_INFO
     kprintf("[I](heapsbrk) called by process(pid: %d, prname: %s), allocating %d bytes\n", currpid, proctab[currpid].prname, nbytes);
 #endif
-    uint32 pgdir = proctab[currpid].phypgdir;
-    uint32 new_pages = Bytes2Pages(nbytes);
     uint32 ori_maxheap = proctab[currpid].maxheap;
-    uint32 tbl_top = (ori_maxheap >> 12) & 0x3ff;
-    uint32 dir_top = (ori_maxheap >> 22) & 0x3ff;
-    uint32 tmp_page, tmp_tbl;
-    uint32 new_maxheap = ori_maxheap + new_pages * PAGE_SIZE;
-    while (new_pages > 0)
-    {
-        tmp_page = (uint32)GetOnePage();
-        if (tbl_top == 0)
-        { // page for a new table is needed;
-            tmp_tbl = (uint32)GetOnePage();
-            MkpgAccessibleby0x1fff000(pgdir);
-            Write0x1fff000(dir_top, tmp_tbl | PTE_P | PTE_W);
-            FlushTlb((void *)0x1fff000);
-        }
-        else
-        {
-            MkpgAccessibleby0x1fff000(pgdir);
-            tmp_tbl = GetEntryFrom0x1fff000(dir_top) & ~0xfff;
-        }
-        if (tbl_top == 1023)
-        {
-            dir_top++;
-        }
-        MkpgAccessibleby0x1fff000(tmp_tbl);
-        Write0x1fff000(tbl_top++, tmp_page | PTE_P | PTE_W);
-        FlushTlb((void *)0x1fff000);
-        tbl_top %= 1024;
-        new_pages--;
+    uint32 new_maxheap = ori_maxheap + Bytes2Pages(nbytes) * PAGE_SIZE;
+    if (new_maxheap > DM_BASE || new_maxheap < ori_maxheap)
+    { // the heap may not grow into the direct map
+        kprintf("[E](heapsbrk) heap of process(pid: %d) would exceed 0x%x\n", currpid, DM_BASE);
+        return SYSERR;
     }
     proctab[currpid].maxheap = new_maxheap;
-    if ((dir_top << 22 | tbl_top << 12) != new_maxheap)
-    {
-        kprintf("[W](heapsbrk) something went wrong, new dir_top is %d, new tbl_top is %d, so maxheap should be (dir_top << 22 | tbl_top << 12) = %d, not %d",
-                dir_top, tbl_top, (dir_top << 22 | tbl_top << 12), new_maxheap);
-    }
     return ori_maxheap;
 }
 
-void InitializeFreeList()
-{ // initialize the free list
-    // kprintf("1");
-    uint32 *tmp_ptr = (uint32 *)heapsbrk(PAGE_SIZE);
-    tmp_ptr += 1; // the actual pointer
-    set_free_boundary_tag(tmp_ptr, PAGE_SIZE);
-    *tmp_ptr = (uint32)tmp_ptr;       // next
-    *(tmp_ptr + 1) = (uint32)tmp_ptr; // prev;
-    proctab[currpid].freelistptr = (uint32)tmp_ptr;
-    // kprintf("2");
-}
-
 void FreeHeapPage(uint32 pgaddr) // recycle the physical page according to the vm address pgaddr, and page table if necessary
 {
-    uint32 pgdir = proctab[currpid].phypgdir;
+    struct page *dir = (struct page *)phys_to_virt(proctab[currpid].phypgdir);
     uint32 dir_top = (pgaddr >> 22) & 0x3ff;
     uint32 tlb_top = (pgaddr >> 12) & 0x3ff;
-    MkpgAccessibleby0x1fff000(pgdir);
-    uint32 pgtb = GetEntryFrom0x1fff000(dir_top) & ~0x3ff; // physical address
-    MkpgAccessibleby0x1fff000(pgtb);
-    uint32 pg = GetEntryFrom0x1fff000(tlb_top) & ~0x3ff;
-    FreeOnePage((struct page *)pg);
+    uint32 pgtb = dir->entries[dir_top] & ~0xfff; // physical address
+    if (!(dir->entries[dir_top] & PTE_P))
+    { // no page of this 4 MB was ever touched
+        return;
+    }
+    struct page *tbl = (struct page *)phys_to_virt(pgtb);
+    uint32 pg = tbl->entries[tlb_top] & ~0xfff;
+    if (tbl->entries[tlb_top] & PTE_P)
+    {
+        tbl->entries[tlb_top] = 0;
+        FlushTlb((void *)pgaddr);
+        PutFrame(pg);
+    }
     if (tlb_top == 0)
     {
+        dir->entries[dir_top] = 0;
         FreeOnePage((struct page *)pgtb);
     }
 }
 
+/*
+ * Give back the frames of the whole pages inside the free block ptr of size
+ * bytes that meet [lo, hi). The pages holding the header, the list links and
+ * the footer stay mapped; the others are backed again with zeroed frames by
+ * PageFault when the block is reused. Returns the number of frames freed.
+ */
+static uint32 TrimFreeBlock(uint32 *ptr, uint32 size, uint32 lo, uint32 hi)
+{
+    uint32 first = ((uint32)(ptr + 2) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1); // first page past the links
+    uint32 last = ((uint32)(ptr - 1) + size - 4) & ~(PAGE_SIZE - 1);      // page of the footer
+    uint32 freed = 0;
+    uint32 *pte;
+    lo &= ~(PAGE_SIZE - 1);
+    if (lo < first)
+    {
+        lo = first;
+    }
+    if (hi > last)
+    {
+        hi = last;
+    }
+    for (; lo < hi; lo += PAGE_SIZE)
+    {
+        pte = PtePtr(proctab[currpid].phypgdir, lo);
+        if (pte != NULL && (*pte & PTE_P))
+        {
+            PutFrame(*pte & ~0xfff);
+            *pte = 0;
+            FlushTlb((void *)lo);
+            freed++;
+        }
+    }
+    heaptrims += freed;
+    return freed;
+}
+
 char *allocmem(
     uint32 nbytes /* Size of memory requested	*/
 )
@@ -326,14 +681,13 @@ char *allocmem(
 #ifdef DEBUG_INFO
     kprintf("[I](allocmem) starts to allocate %d bytes from heap\n", nbytes);
 #endif
-    if (proctab[currpid].freelistptr == NULL)
-    { /* initialize the free list */
-        InitializeFreeList();
-    }
-
     uint32 newsize = ALIGN(nbytes + SIZE_T_SIZE); // actual size needed
+    if (newsize < HEAP_MINBLK)
+    {
+        newsize = HEAP_MINBLK;
+    }
 
-    // Seek in the free list first
+    // Seek in the free lists first
     uint32 *current = scan_free_block(newsize);
     if (current != 0)
     {
@@ -343,74 +697,41 @@ char *allocmem(
         restore(mask);
         return (char *)current;
     }
-    // Cannot find a fine block from the free list
-    uint32 last_byte = proctab[currpid].maxheap - 4;
-    uint32 *pointer = (uint32 *)last_byte;
-    if (!(*pointer & 1) && ((uint32)pointer > KERNEL_END))
-    { // The last block in the heap is empty but it's not large enough, then we can expand it to a extent so that it can contain what it have to
-        uint32 free_size = *pointer & ~3;
-        current = pointer - free_size / 4 + 2;
-        // Optsbrk(current, newsize);
-        uint32 need_size = newsize - free_size;
-        uint32 pages_needed = Bytes2Pages(need_size);
-        uint32 total_size = pages_needed * PAGE_SIZE;
-        uint32 extra_size = total_size - need_size;
-        heapsbrk(total_size);
-        if (extra_size < 16)
-        {
-            delete_free_block(current);
-            set_alloc_boundary_tag(current, free_size + total_size);
-        }
-        else
-        {
-            assign_free_block(current, (uint32 *)(proctab[currpid].maxheap - extra_size + 4), extra_size);
-            set_alloc_boundary_tag(current, newsize);
-        }
-#ifdef DEBUG_INFO
-        kprintf("[I](allocmem) Get pointer 0x%x by sbrk.\n", (uint32)current);
-#endif
-        restore(mask);
-        // kprintf("5");
-        return (char *)current;
-    }
-
-    // No other means but sbrk
-
-    uint32 pages_needed = Bytes2Pages(newsize);
-    uint32 total_size = pages_needed * PAGE_SIZE;
-    uint32 extra_size = total_size - newsize;
-
-    uint32 *p;
-    p = (uint32 *)heapsbrk(total_size);
-    if (extra_size < 16)
-    { // likewise, no new free block comes up
-        set_alloc_boundary_tag(p + 1, total_size);
+    // Nothing fits: grow the heap, merging with the last block if it is free
+    uint32 maxheap = proctab[currpid].maxheap;
+    uint32 free_size = 0;
+    current = (uint32 *)(maxheap + 4);
+    if (maxheap > KERNEL_END && !(*(uint32 *)(maxheap - 4) & 1))
+    {
+        free_size = *(uint32 *)(maxheap - 4) & ~3;
+        current = (uint32 *)(maxheap - free_size + 4);
+        delete_free_block(current);
     }
-    else
-    { // there is a new free block
-        set_alloc_boundary_tag(p + 1, newsize);
-        set_free_boundary_tag((uint32 *)(proctab[currpid].maxheap - extra_size + 4), extra_size);
-        insert_free_block((uint32 *)(proctab[currpid].maxheap - extra_size + 4));
+    uint32 total_size = Bytes2Pages(newsize - free_size) * PAGE_SIZE;
+    if (total_size - (newsize - free_size) < HEAP_MINBLK && total_size - (newsize - free_size) > 0)
+    { // nothing may be left over that cannot hold a free block
+        total_size += PAGE_SIZE;
     }
-    if (p == (void *)(-1))
+    if (heapsbrk(total_size) == SYSERR)
     {
+        if (free_size)
+        {
+            insert_free_block(current);
+        }
         restore(mask);
         return NULL;
     }
-    // set_alloc_boundary_tag(p + 1, newsize);
-    // printf("Get pointer %lx by totally sbrk.\n", (uint32)(p + 1));
+    place_block(current, free_size + total_size, newsize);
 #ifdef DEBUG_INFO
-        kprintf("[I](allocmem) Get pointer 0x%x by sbrk.\n", (uint32)(p + 1));
+    kprintf("[I](allocmem) Get pointer 0x%x by sbrk.\n", (uint32)current);
 #endif
     restore(mask);
-    return (char *)(p + 1);
-
-    // return NULL;
+    return (char *)current;
 }
 
 syscall deallocmem(
     char *blkaddr, /* Pointer to memory block	*/
-    uint32 nbytes  /* Size of block in bytes, because we use free list, this argument has no use	*/
+    uint32 nbytes  /* Size of block in bytes, because we use boundary tags, this argument has no use	*/
 )
 
 {
@@ -421,65 +742,49 @@ syscall deallocmem(
     if ((uint32)blkaddr < KERNEL_END)
     {
         kprintf("[E](deallocmem) free kernel memory\n");
+        restore(mask);
         return SYSERR;
     }
-    // printf("Freeing pointer %lx\n", (uint32)ptr);
 
     uint32 *current = (uint32 *)blkaddr;
     uint32 free_size = *(current - 1) & ~3;
-    // uint32 another_size = *(current - 2) & ~3;
-    // if(another_size > free_size)
-    // {
-    //     my_pause(free_size);
-    //     current -= 1;
-    //     free_size = another_size;
-    // }
-    // printf("the size to be freed is %ld\n", free_size);
-
-    int flag_before = 0;
-
-    if (!(*(current - 2) & 1) && (current - 2) > (uint32 *)KERNEL_END)
-    { // Coalescing with the free block before
+    uint32 lo = (uint32)(current - 2);                  // footer of the block before
+    uint32 hi = (uint32)(current - 1) + free_size + 12; // header and links of the block after
+    uint32 hole = 0;
 
-        // printf("Combining with the free block before\n");
+    if ((uint32)(current - 1) > KERNEL_END && !(*(current - 2) & 1))
+    { // Coalescing with the free block before
         uint32 prev_size = *(current - 2) & ~3;
-
         current -= prev_size / 4; // current is pointed to the combined block
+        hole |= *(current - 1) & HEAP_HOLE;
+        delete_free_block(current);
         free_size += prev_size;
-
-        // check_free_list();
-        flag_before = 1;
     }
-    if (!(*(current + free_size / 4 - 1) & 1) && (current + free_size / 4 - 1) <= (uint32 *)((uint32)proctab[currpid].maxheap - 15))
+    if ((uint32)(current - 1) + free_size < proctab[currpid].maxheap && !(*(current + free_size / 4 - 1) & 1))
     { // Coalescing with the free block after
         uint32 next_size = *(current + free_size / 4 - 1) & ~3;
-
-        // delete it from free list
+        hole |= *(current + free_size / 4 - 1) & HEAP_HOLE;
         delete_free_block(current + free_size / 4);
-
         free_size += next_size;
     }
 
-    if (!flag_before)
-    { // If the freed block didn't coalesce with the block before, then add it to the free list
-        insert_free_block(current);
-    }
-    uint32 pos = (uint32)current;
-    if (pos - 4 + free_size == proctab[currpid].maxheap)
-    {
-        while (free_size >= PAGE_SIZE)
+    if ((uint32)(current - 1) + free_size == proctab[currpid].maxheap)
+    { // give whole pages at the top of the heap back
+        while (free_size == PAGE_SIZE || free_size >= PAGE_SIZE + HEAP_MINBLK)
         {
             FreeHeapPage(proctab[currpid].maxheap -= PAGE_SIZE);
             free_size -= PAGE_SIZE;
         }
     }
-    if (free_size == 0)
-    {
-        delete_free_block(current);
-    }
-    else
+    if (free_size > 0)
     {
         set_free_boundary_tag(current, free_size);
+        // pages already inside a free neighbour were given back when it was freed
+        if (TrimFreeBlock(current, free_size, lo, hi) > 0 || hole)
+        {
+            *(current - 1) |= HEAP_HOLE;
+        }
+        insert_free_block(current);
     }
 #ifdef DEBUG_INFO
     kprintf("[I](deallocmem) done.\n", blkaddr);
@@ -495,74 +800,301 @@ char *allocstk(
 {
     intmask mask = disable();
     uint32 pages_needed = Bytes2Pages(nbytes);
+    struct page *dir = (struct page *)phys_to_virt(pgdir);
+    struct page *kdir = (struct page *)KERNEL_PGDIR;
+    struct page *tbl;
+    int i;
 #ifdef DEBUG_INFO
     kprintf("[I](allocstk) process(pid: %d, prname: %s) allocates %d page(s) for the process whose page directory's physical address is 0x%x\n", currpid, proctab[currpid].prname, pages_needed, pgdir);
 #endif
-    MkpgAccessibleby0x1fff000(pgdir);
-    for (int i = 0; i <= 7; i++)
+    for (i = 0; i <= 7; i++)
     {
-        Write0x1fff000(i, (KERNEL_END - (9 - i) * PAGE_SIZE) | PTE_P | PTE_W); // copy 0 - 32 MB
+        dir->entries[i] = kdir->entries[i]; // share 0 - 32 MB
+    }
+    for (i = 0; i < ndmpdes; i++)
+    {
+        dir->entries[DM_PDE + i] = kdir->entries[DM_PDE + i]; // share the direct map
+    }
+    dir->entries[KSTK_PDE] = kdir->entries[KSTK_PDE]; // prnull may run in any address space
+    dir->entries[MMIO_PDE] = kdir->entries[MMIO_PDE]; // APIC registers, if smpinit mapped them
+    if (pages_needed > 1024)
+    { // the stack has a single page table
+        restore(mask);
+        return (char *)SYSERR;
     }
     uint32 stk_pgtb = (uint32)GetOnePage(); // one page table is enough for 4MB‘s stack
 #ifdef DEBUG_INFO
     kprintf("[I](allocstk) new process's stack page table's physical address is 0x%x\n", stk_pgtb);
 #endif
-    MkpgAccessibleby0x1fff000(pgdir);
-    Write0x1fff000(1023, stk_pgtb | PTE_P | PTE_W); // virtual high 10 bits: 1111111111 -> 1023
-    MkpgAccessibleby0x1fff000(stk_pgtb);            // now the only stack page table page can be accessed by 0x1fff000
-    memset((void *)0x1fff000, 0, PAGE_SIZE);
-    uint32 stk_pg, stk_pg_one;
-    for (int i = 0; i < pages_needed; i++)
-    {
-        stk_pg = (uint32)GetOnePage();
-        if (i == 0)
-        {
-#ifdef DEBUG_INFO
-            kprintf("[I](allocstk) new process's stack page(last)'s physical address is 0x%x\n", stk_pg);
-#endif
-            stk_pg_one = stk_pg;
-        }
-        MkpgAccessibleby0x1fff000(stk_pgtb);              // now the only stack page table page can be accessed by 0x1fff000
-        Write0x1fff000(1023 - i, stk_pg | PTE_P | PTE_W); // virtual low 10 bits from 1111111111 to 0
-    }
-    MkpgAccessibleby0x1fff000(stk_pg_one); // still use temp, then we can initialize the stack by 0x1fff000 in the rest of create
+    dir->entries[1023] = stk_pgtb | PTE_P | PTE_W; // virtual high 10 bits: 1111111111 -> 1023
+    tbl = (struct page *)phys_to_virt(stk_pgtb);
+    // only the top page, where create() builds the initial frame, is backed now;
+    // the rest of the pages_needed pages are backed by PageFault when touched
+    tbl->entries[1023] = (uint32)GetOnePage() | PTE_P | PTE_W;
     restore(mask);
-    return (char *)0xfffffffc;             // 4GB - 4
+    return (char *)0xfffffffc; // 4GB - 4
 }
 
 void deallocstk(uint32 pgdir)
 {
     intmask mask = disable();
+    struct page *dir = (struct page *)phys_to_virt(pgdir);
+    struct page *tbl;
+    int i, j;
 #ifdef DEBUG_INFO
     kprintf("[I](deallocstk) free stack's page directory 0x%x\n", pgdir);
 #endif
-    FreeOnePage((struct page *)pgdir);
-    struct page *pgptr = (struct page *)0x1fff000;
-    MkpgAccessibleby0x1fff000(pgdir);
-    uint32 sv_pgdr;
-    for (int i = 1023; i >= 8; i--)
+    if (isidlepid(currpid) && ReadCr3() == pgdir)
+    { // the idle process has been borrowing this address space
+        cpuself()->cpcr3 = KERNEL_PGDIR;
+        asm volatile("movl %0, %%cr3" : : "r"(KERNEL_PGDIR) : "memory");
+    }
+    tlbevict(pgdir); // and so may those of other processors
+    for (i = 1023; i >= 8; i--)
     {
-        if ((pgptr->entries[i] & PTE_P))
+        if (IsKernelPde(i))
+        { // shared by all processes
+            continue;
+        }
+        if ((dir->entries[i] & PTE_P))
         {
 #ifdef DEBUG_INFO
-            kprintf("[I](deallocstk) free stack's page table whose physical address is 0x%x(on pgdir[%d], PA = 0x%x)\n", (uint32)(pgptr->entries[i]), i, pgdir + i * 4);
+            kprintf("[I](deallocstk) free stack's page table whose physical address is 0x%x(on pgdir[%d], PA = 0x%x)\n", (uint32)(dir->entries[i]), i, pgdir + i * 4);
 #endif
-            sv_pgdr = GetEntryFrom0x1fff000(i) & ~0xfff;
-            FreeOnePage((struct page *)sv_pgdr); // free all page tables
-            MkpgAccessibleby0x1fff000(sv_pgdr);
-            for (int j = 1023; j >= 0; j--)
+            tbl = (struct page *)phys_to_virt(dir->entries[i] & ~0xfff);
+            for (j = 1023; j >= 0; j--)
             {
-                if ((pgptr->entries[j] & PTE_P) && (pgptr->entries[j] & PTE_W))
+                if (tbl->entries[j] & PTE_P)
                 {
 #ifdef DEBUG_INFO
-                    kprintf("[I](deallocstk) free stack's page 0x%x\n", (uint32)(pgptr->entries[j] & ~0xfff));
+                    kprintf("[I](deallocstk) free stack's page 0x%x\n", (uint32)(tbl->entries[j] & ~0xfff));
 #endif
-                    FreeOnePage((struct page *)(pgptr->entries[j] & ~0xfff)); // free all pages
+                    PutFrame(tbl->entries[j] & ~0xfff); // free all pages not shared with a fork
                 }
             }
-            MkpgAccessibleby0x1fff000(pgdir); // make page dir accessible again to continue the loop
+            FreeOnePage((struct page *)(dir->entries[i] & ~0xfff)); // free all page tables
+        }
+    }
+    FreeOnePage((struct page *)pgdir);
+    restore(mask);
+}
+
+/*
+ * Back the page holding vaddr in the address space of page directory pgdir
+ * with a zeroed frame, and its page table too if needed. Returns the physical
+ * address vaddr maps to, or SYSERR when out of frames.
+ */
+uint32 MapZeroPage(uint32 pgdir, uint32 vaddr)
+{
+    intmask mask = disable();
+    struct page *dir = (struct page *)phys_to_virt(pgdir);
+    struct page *tbl;
+    uint32 dir_top = (vaddr >> 22) & 0x3ff;
+    uint32 tbl_top = (vaddr >> 12) & 0x3ff;
+    uint32 pg;
+    if (!(dir->entries[dir_top] & PTE_P))
+    {
+        pg = (uint32)GetPages(0);
+        if (!pg)
+        {
+            restore(mask);
+            return SYSERR;
+        }
+        dir->entries[dir_top] = pg | PTE_P | PTE_W;
+    }
+    tbl = (struct page *)phys_to_virt(dir->entries[dir_top] & ~0xfff);
+    if (!(tbl->entries[tbl_top] & PTE_P))
+    { // an empty table left behind on failure is freed with the address space
+        pg = (uint32)GetPages(0);
+        if (!pg)
+        {
+            restore(mask);
+            return SYSERR;
         }
+        tbl->entries[tbl_top] = pg | PTE_P | PTE_W;
+        pgfaults++;
+    }
+    pg = tbl->entries[tbl_top] & ~0xfff;
+    restore(mask);
+    return pg | (vaddr & 0xfff);
+}
+
+/*
+ * Make the page holding vaddr writable in the address space of pgdir: a
+ * page still shared copy-on-write gets a private copy, or is simply taken
+ * over by its last sharer. Returns the physical address vaddr maps to, or
+ * SYSERR if the page is absent, read-only for good, or no frame is left.
+ */
+uint32 CopyOnWrite(uint32 pgdir, uint32 vaddr)
+{
+    intmask mask = disable();
+    uint32 *pte = PtePtr(pgdir, vaddr);
+    uint32 old, new;
+    int32 index;
+    if (pte == NULL || !(*pte & PTE_P) || (*pte & PTE_W))
+    {
+        restore(mask);
+        return VirtToPhys(pgdir, vaddr);
+    }
+    if (!(*pte & PTE_COW))
+    {
+        restore(mask);
+        return SYSERR;
+    }
+    old = *pte & ~0xfff;
+    index = FrameIndex(old);
+    if (index != SYSERR && frtab[index].fe_refs > 1)
+    {
+        new = (uint32)GetPages(0);
+        if (!new)
+        {
+            restore(mask);
+            return SYSERR;
+        }
+        memcpy(phys_to_virt(new), phys_to_virt(old), PAGE_SIZE);
+        PutFrame(old); // frees it if the other sharers are gone by now
+        cowcopies++;
+    }
+    else
+    { // every other sharer has written or exited already
+        new = old;
+    }
+    *pte = new | (*pte & 0xfff & ~PTE_COW) | PTE_W;
+    if (pgdir == ReadCr3())
+    {
+        FlushTlb((void *)vaddr);
+    }
+    else
+    { // from the page fault task: the faulting process reloads CR3
+        tlbshootdown(pgdir);
     }
     restore(mask);
+    return new | (vaddr & 0xfff);
+}
+
+/*
+ * Give process pid, a copy of the current process, the current address
+ * space: kernel entries are shared as usual, the heap and stack page tables
+ * are copied and every page they map becomes read-only and copy-on-write in
+ * both. Called by forkctx with the child's initial frame already saved on
+ * the stack, so the child sees it.
+ */
+status ForkSpace(pid32 pid)
+{
+    struct page *pdir = (struct page *)phys_to_virt(proctab[currpid].phypgdir);
+    struct page *cdir = (struct page *)phys_to_virt(proctab[pid].phypgdir);
+    struct page *ptbl, *ctbl;
+    uint32 tbl;
+    int i, j;
+    for (i = 0; i < 1024; i++)
+    {
+        if (IsKernelPde(i) || !(pdir->entries[i] & PTE_P))
+        {
+            cdir->entries[i] = pdir->entries[i];
+            continue;
+        }
+        tbl = (uint32)GetPages(0);
+        if (!tbl)
+        {
+            return SYSERR;
+        }
+        cdir->entries[i] = tbl | (pdir->entries[i] & 0xfff);
+        ptbl = (struct page *)phys_to_virt(pdir->entries[i] & ~0xfff);
+        ctbl = (struct page *)phys_to_virt(tbl);
+        for (j = 0; j < 1024; j++)
+        {
+            if (ptbl->entries[j] & PTE_W)
+            {
+                ptbl->entries[j] = (ptbl->entries[j] & ~PTE_W) | PTE_COW;
+            }
+            if (ptbl->entries[j] & PTE_P)
+            {
+                ShareFrame(ptbl->entries[j] & ~0xfff);
+            }
+            ctbl->entries[j] = ptbl->entries[j];
+        }
+    }
+    asm volatile( // drop the writable TLB entries of the current process
+        "movl %%cr3, %%eax\n\t"
+        "movl %%eax, %%cr3\n\t"
+        :
+        :
+        : "eax", "memory");
+    tlbshootdown(proctab[currpid].phypgdir);
+    return OK;
+}
+
+/*
+ * Where a process killed by PageFault resumes: on top of its own stack,
+ * whose top page is always backed
+ */
+static void PageFaultKill(void)
+{
+    kill(currpid);
 }
 
+/*
+ * Handle a page fault of the current process, saved in tssmain. A
+ * not-present fault inside the heap or stack reservation gets a fresh
+ * zeroed page and the access is retried; anything else is reported and the
+ * process is killed.
+ */
+static void PageFaultHandle(uint32 errcode, struct tss *tssmain)
+{
+    struct procent *prptr = &proctab[currpid];
+    uint32 vaddr = ReadCr2();
+    const char *reason = "invalid access to";
+    tssmain->tss_cr3 = prptr->phypgdir; // the CPU reloads CR3 from here, it never saves it
+    if (!isidlepid(currpid) && !(errcode & PF_P) &&
+        ((vaddr >= KERNEL_END && vaddr < prptr->maxheap) || vaddr >= StackBottom(prptr)))
+    {
+        if (MapZeroPage(prptr->phypgdir, vaddr) != SYSERR)
+        {
+            return;
+        }
+        reason = "out of memory backing";
+    }
+    else if (!isidlepid(currpid) && (errcode & PF_P) && (errcode & PF_W))
+    { // write to a page shared copy-on-write after fork
+        if (CopyOnWrite(prptr->phypgdir, vaddr) != SYSERR)
+        {
+            return;
+        }
+        reason = "write to read-only or out of memory copying";
+    }
+    kprintf("[E](PageFault) process(pid: %d, prname: %s): %s 0x%x on %s at eip 0x%x (error code 0x%x)\n",
+            currpid, prptr->prname, reason, vaddr, (errcode & PF_W) ? "write" : "read", tssmain->tss_eip, errcode);
+    kprintf("[E](PageFault) heap 0x%x - 0x%x, stack 0x%x - 0xffffffff\n",
+            KERNEL_END, prptr->maxheap, StackBottom(prptr));
+    if (isidlepid(currpid))
+    {
+        panic("Page fault in the null process");
+    }
+    tssmain->tss_eip = (uint32)PageFaultKill;
+    tssmain->tss_esp = tssmain->tss_ebp = (uint32)prptr->prstkbase;
+}
+
+/*
+ * Page fault handler, run by the page fault task (see initpftask) with the
+ * faulting process saved in the cptssmain of its processor. The task runs
+ * with interrupts disabled, so with SMP it takes the kernel lock itself
+ * unless the faulting code held it already.
+ */
+void PageFault(uint32 errcode)
+{
+    struct tss *tssmain = &cpuself()->cptssmain;
+#ifdef SMP
+    bool8 lock = (tssmain->tss_eflags & EFLAGS_IF) != 0;
+    if (lock)
+    {
+        klockacquire();
+    }
+    PageFaultHandle(errcode, tssmain);
+    if (lock)
+    {
+        klockrelease();
+    }
+#else
+    PageFaultHandle(errcode, tssmain);
+#endif
+}